@@ -1,4 +1,3 @@
-#include <netinet/tcp.h>
 #include <QtEndian>
 #include <QEventLoop>
 #include <QThread>
@@ -7,19 +6,15 @@
 #include "logger.h"
 #include "zcl.h"
 
-Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiveTimer(new QTimer(this)), m_resetTimer(new QTimer(this)), m_permitJoinTimer(new QTimer(this)), m_serial(new QSerialPort(this)), m_socket(new QTcpSocket(this)), m_serialError(false), m_connected(false), m_permitJoin(false)
+Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_resetTimer(new QTimer(this)), m_permitJoinTimer(new QTimer(this)), m_thread(new QThread(this)), m_serialError(false), m_requestLimit(DEFAULT_REQUEST_LIMIT), m_permitJoin(false), m_extendedTimeout(false), m_routeDiscovery(false), m_transmitFrames(0)
 {
     QString portName = config->value("zigbee/port", "/dev/ttyUSB0").toString();
 
     if (!portName.startsWith("tcp://"))
     {
-        m_device = m_serial;
-
-        m_serial->setPortName(portName);
-        m_serial->setBaudRate(config->value("zigbee/baudrate", 115200).toInt());
-        m_serial->setDataBits(QSerialPort::Data8);
-        m_serial->setParity(QSerialPort::NoParity);
-        m_serial->setStopBits(QSerialPort::OneStop);
+        m_transport = new Transport(portName, config->value("zigbee/baudrate", 115200).toInt());
+        m_serial = true;
+        m_portName = portName;
 
         m_bootPin = config->value("gpio/boot", "-1").toString();
         m_resetPin = config->value("gpio/reset", "-1").toString();
@@ -28,18 +23,20 @@ Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiv
         GPIO::direction(m_bootPin, GPIO::Output);
         GPIO::direction(m_resetPin, GPIO::Output);
 
-        connect(m_serial, &QSerialPort::errorOccurred, this, &Adapter::serialError);
+        connect(m_transport, &Transport::serialError, this, &Adapter::serialError);
     }
     else
     {
         QList <QString> list = portName.remove("tcp://").split(":");
 
-        m_device = m_socket;
         m_adddress = QHostAddress(list.value(0));
         m_port = static_cast <quint16> (list.value(1).toInt());
 
-        connect(m_socket, &QTcpSocket::errorOccurred, this, &Adapter::socketError);
-        connect(m_socket, &QTcpSocket::connected, this, &Adapter::socketConnected);
+        m_transport = new Transport(m_adddress, m_port, config->value("zigbee/nodelay", true).toBool());
+        m_serial = false;
+
+        connect(m_transport, &Transport::connectionError, this, &Adapter::socketError);
+        connect(m_transport, &Transport::connected, this, &Adapter::socketConnected);
     }
 
     m_panId = static_cast <quint16> (config->value("zigbee/panid", "0x1010").toString().toInt(nullptr, 16));
@@ -50,6 +47,22 @@ Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiv
     m_portDebug = config->value("debug/port", false).toBool();
     m_adapterDebug = config->value("debug/adapter", false).toBool();
 
+    m_captureFile.setFileName(config->value("debug/capture").toString());
+    m_replayFile.setFileName(config->value("debug/replay").toString());
+    m_replayRealtime = config->value("debug/realtime", true).toBool();
+
+    if (!m_captureFile.fileName().isEmpty())
+    {
+        if (m_captureFile.open(QFile::WriteOnly))
+        {
+            m_captureFile.write(CAPTURE_SIGNATURE);
+            m_captureTimer.start();
+            m_captureRecords = 0;
+        }
+        else
+            logWarning << "Capture file" << m_captureFile.fileName() << "open error:" << m_captureFile.errorString();
+    }
+
     m_networkKey = QByteArray::fromHex(config->value("security/key", "000102030405060708090a0b0c0d0e0f").toString().remove("0x").toUtf8());
 
     if (m_channel < 11 || m_channel > 26)
@@ -112,31 +125,72 @@ Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiv
     m_multicast.append(IKEA_GROUP);
     m_multicast.append(GREEN_POWER_GROUP);
 
-    connect(m_device, &QIODevice::readyRead, this, &Adapter::startTimer);
-    connect(m_receiveTimer, &QTimer::timeout, this, &Adapter::readyRead);
+    qRegisterMetaType <QSerialPort::SerialPortError> ("QSerialPort::SerialPortError");
+    qRegisterMetaType <QTcpSocket::SocketError> ("QTcpSocket::SocketError");
+
+    if (m_replayFile.fileName().isEmpty())
+    {
+        m_transport->moveToThread(m_thread);
+        m_thread->start();
+    }
+
+    connect(m_thread, &QThread::finished, m_transport, &QObject::deleteLater);
+    connect(m_transport, &Transport::dataReceived, this, &Adapter::readyRead);
     connect(m_resetTimer, &QTimer::timeout, this, &Adapter::resetTimeout);
     connect(m_permitJoinTimer, &QTimer::timeout, this, &Adapter::permitJoinTimeout);
 
-    m_receiveTimer->setSingleShot(true);
     m_resetTimer->setSingleShot(true);
 }
 
 Adapter::~Adapter(void)
 {
-    if (m_connected)
-        m_socket->disconnectFromHost();
+    if (m_thread->isRunning())
+    {
+        QMetaObject::invokeMethod(m_transport, "close", Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+    }
+    else
+        delete m_transport;
+
+    if (m_captureFile.isOpen())
+        m_captureFile.close();
 }
 
 void Adapter::init(void)
 {
-    if (m_device == m_serial)
+    if (!m_replayFile.fileName().isEmpty())
     {
-        if (m_serial->isOpen())
-            m_serial->close();
+        if (m_replayFile.isOpen())
+            return;
 
-        if (m_serial->open(QIODevice::ReadWrite))
+        if (!m_replayFile.open(QFile::ReadOnly) || m_replayFile.read(strlen(CAPTURE_SIGNATURE)) != CAPTURE_SIGNATURE)
         {
-            logInfo << "Port" << m_serial->portName() << "opened successfully";
+            logWarning << "Replay file" << m_replayFile.fileName() << "is invalid";
+            return;
+        }
+
+        logInfo << "Replaying capture file" << m_replayFile.fileName() << (m_replayRealtime ? "at original speed" : "at maximum speed");
+
+        m_replayFrames = 0;
+        m_replayTimer.start();
+
+        m_buffer.clear();
+        emit adapterReset();
+
+        replayData();
+        return;
+    }
+
+    if (m_serial)
+    {
+        bool result = false;
+
+        QMetaObject::invokeMethod(m_transport, "open", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, result));
+
+        if (result)
+        {
+            logInfo << "Port" << m_portName << "opened successfully";
             reset();
         }
     }
@@ -148,10 +202,7 @@ void Adapter::init(void)
             return;
         }
 
-        if (m_connected)
-            m_socket->disconnectFromHost();
-
-        m_socket->connectToHost(m_adddress, m_port);
+        QMetaObject::invokeMethod(m_transport, "open", Qt::QueuedConnection);
     }
 }
 
@@ -239,7 +290,11 @@ void Adapter::reset(void)
 {
     QList <QString> list = {"gpio", "flow"};
 
-    m_device->readAll();
+    QMetaObject::invokeMethod(m_transport, "clear", Qt::BlockingQueuedConnection);
+    m_transport->read();
+    m_buffer.clear();
+    m_transmitData.clear();
+    m_transmitFrames = 0;
     m_resetTimer->start(RESET_TIMEOUT);
 
     logInfo << "Resetting adapter" << QString("(%1)").arg(list.contains(m_reset) ? m_reset : "soft").toUtf8().constData();
@@ -255,10 +310,7 @@ void Adapter::reset(void)
             break;
 
         case 1:
-            m_serial->setRequestToSend(true);
-            m_serial->setDataTerminalReady(false);
-            QThread::msleep(RESET_DELAY);
-            m_serial->setRequestToSend(false);
+            QMetaObject::invokeMethod(m_transport, "flowReset", Qt::BlockingQueuedConnection, Q_ARG(int, RESET_DELAY));
             break;
 
         default:
@@ -270,7 +322,59 @@ void Adapter::reset(void)
 void Adapter::sendData(const QByteArray &buffer)
 {
     logDebug(m_portDebug) << "Serial data sent:" << buffer.toHex(':');
-    m_device->write(buffer);
+    captureData(CAPTURE_SENT, buffer);
+
+    if (m_replayFile.isOpen())
+        return;
+
+    if (m_transmitData.isEmpty())
+        QTimer::singleShot(0, this, &Adapter::flushData);
+
+    m_transmitData.append(buffer);
+    m_transmitFrames++;
+}
+
+void Adapter::flushData(void)
+{
+    if (m_transmitData.isEmpty())
+        return;
+
+    if (!m_transport->write(m_transmitData, m_transmitFrames))
+        logWarning << "Transport buffer overflow," << m_transmitFrames << "frames dropped";
+
+    m_transmitData.clear();
+    m_transmitFrames = 0;
+}
+
+void Adapter::captureData(quint8 direction, const QByteArray &data)
+{
+    captureRecordStruct record;
+
+    if (!m_captureFile.isOpen())
+        return;
+
+    record.timestamp = qToLittleEndian <quint64> (m_captureTimer.nsecsElapsed() / 1000);
+    record.direction = direction;
+    record.length = qToLittleEndian <quint32> (data.length());
+
+    m_captureFile.write(reinterpret_cast <char*> (&record), sizeof(record));
+    m_captureFile.write(data);
+
+    if (++m_captureRecords % CAPTURE_FLUSH_RECORDS)
+        return;
+
+    m_captureFile.flush();
+}
+
+void Adapter::receiveData(const QByteArray &data)
+{
+    logDebug(m_portDebug) << "Serial data received:" << data.toHex(':');
+
+    m_buffer.append(data);
+    parseData(m_buffer);
+
+    if (!m_queue.isEmpty())
+        QTimer::singleShot(0, this, &Adapter::handleQueue);
 }
 
 void Adapter::serialError(QSerialPort::SerialPortError error)
@@ -292,42 +396,61 @@ void Adapter::socketError(QTcpSocket::SocketError error)
 {
     logWarning << "Connection error:" << error;
     m_resetTimer->start(RESET_TIMEOUT);
-    m_connected = false;
 }
 
 void Adapter::socketConnected(void)
 {
-    int descriptor = m_socket->socketDescriptor(), keepAlive = 1, interval = 10, count = 3;
-
-    setsockopt(descriptor, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(keepAlive));
-    setsockopt(descriptor, SOL_TCP, TCP_KEEPIDLE, &interval, sizeof(interval));
-    setsockopt(descriptor, SOL_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
-    setsockopt(descriptor, SOL_TCP, TCP_KEEPCNT, &count, sizeof(count));
-
     logInfo << "Successfully connected to" << QString("%1:%2").arg(m_adddress.toString()).arg(m_port);
-
-    m_connected = true;
     reset();
 }
 
-void Adapter::startTimer(void)
+void Adapter::readyRead(void)
 {
-    m_receiveTimer->start(RECEIVE_TIMEOUT);
+    QByteArray data = m_transport->read();
+
+    if (data.isEmpty())
+        return;
+
+    captureData(CAPTURE_RECEIVED, data);
+    receiveData(data);
 }
 
-void Adapter::readyRead(void)
+void Adapter::replayData(void)
 {
-    QByteArray buffer = m_device->readAll();
+    while (m_replayFile.bytesAvailable() >= static_cast <qint64> (sizeof(captureRecordStruct)))
+    {
+        QByteArray header = m_replayFile.peek(sizeof(captureRecordStruct)), data;
+        const captureRecordStruct *record = reinterpret_cast <const captureRecordStruct*> (header.constData());
+        qint64 delay = static_cast <qint64> (qFromLittleEndian(record->timestamp) / 1000) - m_replayTimer.elapsed();
 
-    logDebug(m_portDebug)  << "Serial data received:" << buffer.toHex(':');
-    parseData(buffer);
+        if (m_replayRealtime && delay > 0)
+        {
+            QTimer::singleShot(delay, this, &Adapter::replayData);
+            return;
+        }
+
+        m_replayFile.read(sizeof(captureRecordStruct));
+        data = m_replayFile.read(qFromLittleEndian(record->length));
+
+        if (record->direction != CAPTURE_RECEIVED)
+            continue;
+
+        m_replayFrames++;
+        receiveData(data);
+
+        if (m_replayRealtime)
+            continue;
+
+        QTimer::singleShot(0, this, &Adapter::replayData);
+        return;
+    }
 
-    QTimer::singleShot(0, this, &Adapter::handleQueue);
+    logInfo << "Replay finished," << m_replayFrames << "frames received in" << m_replayTimer.elapsed() << "ms";
 }
 
 void Adapter::resetTimeout(void)
 {
-    if (m_serial->isOpen() || m_connected)
+    if (m_transport->isOpen())
         logWarning << "Adapter reset timed out";
 
     init();
@@ -1,14 +1,19 @@
 #ifndef ADAPTER_H
 #define ADAPTER_H
 
-#define RECEIVE_TIMEOUT                 20
-
 #define PERMIT_JOIN_TIMEOUT             60000
 #define PERMIT_JOIN_BROARCAST_ADDRESS   0xFFFC
 
 #define RESET_TIMEOUT                   15000
 #define RESET_DELAY                     100
 
+#define DEFAULT_REQUEST_LIMIT           8
+
+#define CAPTURE_SIGNATURE               "HZCAP1"
+#define CAPTURE_RECEIVED                0x00
+#define CAPTURE_SENT                    0x01
+#define CAPTURE_FLUSH_RECORDS           16
+
 #define DEFAULT_GROUP                   0x0000
 #define IKEA_GROUP                      0x0385
 #define GREEN_POWER_GROUP               0x0B84
@@ -37,13 +42,14 @@
 #define ADDRESS_MODE_64_BIT             0x03
 #define ADDRESS_MODE_BROADCAST          0xFF
 
-#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QQueue>
-#include <QSerialPort>
 #include <QSettings>
 #include <QSharedPointer>
-#include <QTcpSocket>
+#include <QThread>
 #include <QTimer>
+#include "transport.h"
 
 enum class LogicalType
 {
@@ -121,6 +127,16 @@ struct bindRequestStruct
     quint8  dstAddressMode;
 };
 
+// capture file is CAPTURE_SIGNATURE followed by records of this packed little-endian 13-byte header and raw port data,
+// timestamp is in microseconds since capture start, direction is CAPTURE_RECEIVED or CAPTURE_SENT, length is data size
+
+struct captureRecordStruct
+{
+    quint64 timestamp;
+    quint8  direction;
+    quint32 length;
+};
+
 #pragma pack(pop)
 
 class EndpointDataObject;
@@ -175,7 +191,14 @@ public:
     inline QByteArray ieeeAddress(void) { return m_ieeeAddress; }
     inline quint8 replyStatus(void) { return m_replyStatus; }
 
-    inline void setRequestParameters(const QByteArray &value, bool extendedTimeout = true) { m_requestAddress = value; m_extendedTimeout = extendedTimeout; }
+    inline QJsonObject statistics(void) { return m_transport->statistics(); }
+
+    inline quint8 requestLimit(void) { return m_requestLimit; }
+    inline bool congestionStatus(quint8 value) { return m_congestionStatus.contains(value); }
+    inline bool deliveryStatus(quint8 value) { return m_deliveryStatus.contains(value); }
+    inline bool macStatus(quint8 value) { return m_macStatus.contains(value); }
+
+    inline void setRequestParameters(const QByteArray &value, bool extendedTimeout = true, bool routeDiscovery = false) { m_requestAddress = value; m_extendedTimeout = extendedTimeout; m_routeDiscovery = routeDiscovery; }
 
     void init(void);
     bool waitForSignal(const QObject *sender, const char *signal, int tiomeout);
@@ -190,17 +213,15 @@ public:
 
 protected:
 
-    QTimer *m_receiveTimer, *m_resetTimer, *m_permitJoinTimer;
-
-    QSerialPort *m_serial;
-    QTcpSocket *m_socket;
-    QIODevice *m_device;
+    QTimer *m_resetTimer, *m_permitJoinTimer;
 
-    bool m_serialError;
+    QThread *m_thread;
+    Transport *m_transport;
+    bool m_serial, m_serialError;
 
+    QString m_portName;
     QHostAddress m_adddress;
     quint16 m_port;
-    bool m_connected;
 
     QString m_bootPin, m_resetPin, m_reset;
     quint16 m_panId;
@@ -210,21 +231,35 @@ protected:
     QString m_manufacturerName, m_modelName, m_firmware;
     QByteArray m_networkKey, m_defaultKey, m_ieeeAddress;
 
-    quint8 m_replyStatus;
+    quint8 m_replyStatus, m_requestLimit;
     bool m_permitJoin;
 
     QByteArray m_requestAddress;
-    bool m_extendedTimeout;
+    bool m_extendedTimeout, m_routeDiscovery;
 
     QMap <quint8, EndpointData> m_endpoints;
     QList <quint16> m_multicast;
+    QList <quint8> m_congestionStatus, m_deliveryStatus, m_macStatus;
+    QByteArray m_buffer;
     QQueue <QByteArray> m_queue;
 
     void reset(void);
     void sendData(const QByteArray &buffer);
+    void flushData(void);
 
 private:
 
+    QByteArray m_transmitData;
+    quint32 m_transmitFrames;
+
+    QFile m_captureFile, m_replayFile;
+    QElapsedTimer m_captureTimer, m_replayTimer;
+    quint32 m_captureRecords, m_replayFrames;
+    bool m_replayRealtime;
+
+    void captureData(quint8 direction, const QByteArray &data);
+    void receiveData(const QByteArray &data);
+
     virtual void softReset(void) = 0;
     virtual void parseData(QByteArray &buffer) = 0;
     virtual bool permitJoin(bool enabled) = 0;
@@ -239,8 +274,8 @@ private slots:
     void socketError(QTcpSocket::SocketError error);
     void socketConnected(void);
 
-    void startTimer(void);
     void readyRead(void);
+    void replayData(void);
     void resetTimeout(void);
     void permitJoinTimeout(void);
 
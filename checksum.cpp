@@ -0,0 +1,169 @@
+#include <string.h>
+#include "checksum.h"
+
+#define ASH_BYTE_RESERVED               0x01
+#define ASH_BYTE_CONTROL                0x02
+
+static quint16 ccittTable[8][256], kermitTable[8][256];
+static quint8 ashTable[256];
+
+static bool initTables(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        quint16 ccitt = static_cast <quint16> (i << 8), kermit = static_cast <quint16> (i);
+
+        for (int j = 0; j < 8; j++)
+        {
+            ccitt = ccitt & 0x8000 ? static_cast <quint16> (ccitt << 1) ^ 0x1021 : static_cast <quint16> (ccitt << 1);
+            kermit = kermit & 0x0001 ? (kermit >> 1) ^ 0x8408 : kermit >> 1;
+        }
+
+        ccittTable[0][i] = ccitt;
+        kermitTable[0][i] = kermit;
+    }
+
+    for (int i = 1; i < 8; i++)
+    {
+        for (int j = 0; j < 256; j++)
+        {
+            ccittTable[i][j] = static_cast <quint16> (ccittTable[i - 1][j] << 8) ^ ccittTable[0][ccittTable[i - 1][j] >> 8];
+            kermitTable[i][j] = (kermitTable[i - 1][j] >> 8) ^ kermitTable[0][kermitTable[i - 1][j] & 0xFF];
+        }
+    }
+
+    ashTable[0x11] = ASH_BYTE_RESERVED | ASH_BYTE_CONTROL;
+    ashTable[0x13] = ASH_BYTE_RESERVED | ASH_BYTE_CONTROL;
+    ashTable[0x18] = ASH_BYTE_RESERVED;
+    ashTable[0x1A] = ASH_BYTE_RESERVED | ASH_BYTE_CONTROL;
+    ashTable[0x7D] = ASH_BYTE_RESERVED | ASH_BYTE_CONTROL;
+    ashTable[0x7E] = ASH_BYTE_RESERVED;
+
+    return true;
+}
+
+static const bool tablesReady = initTables();
+
+quint16 crcCCITT(const quint8 *data, quint32 length, quint16 crc)
+{
+    Q_UNUSED(tablesReady);
+
+    while (length >= 8)
+    {
+        crc = ccittTable[7][data[0] ^ (crc >> 8)] ^ ccittTable[6][data[1] ^ (crc & 0xFF)] ^ ccittTable[5][data[2]] ^ ccittTable[4][data[3]] ^ ccittTable[3][data[4]] ^ ccittTable[2][data[5]] ^ ccittTable[1][data[6]] ^ ccittTable[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+        crc = static_cast <quint16> (crc << 8) ^ ccittTable[0][(crc >> 8) ^ *data++];
+
+    return crc;
+}
+
+quint16 crcKermit(const quint8 *data, quint32 length, quint16 crc)
+{
+    Q_UNUSED(tablesReady);
+
+    while (length >= 8)
+    {
+        crc = kermitTable[7][data[0] ^ (crc & 0xFF)] ^ kermitTable[6][data[1] ^ (crc >> 8)] ^ kermitTable[5][data[2]] ^ kermitTable[4][data[3]] ^ kermitTable[3][data[4]] ^ kermitTable[2][data[5]] ^ kermitTable[1][data[6]] ^ kermitTable[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+        crc = (crc >> 8) ^ kermitTable[0][(crc ^ *data++) & 0xFF];
+
+    return crc;
+}
+
+quint8 xorChecksum(const quint8 *data, quint32 length, quint8 checksum)
+{
+    quint64 value = 0;
+
+    while (length >= sizeof(value))
+    {
+        quint64 word;
+        memcpy(&word, data, sizeof(word));
+        value ^= word;
+        data += sizeof(word);
+        length -= sizeof(word);
+    }
+
+    value ^= value >> 32;
+    value ^= value >> 16;
+    value ^= value >> 8;
+    checksum ^= static_cast <quint8> (value);
+
+    while (length--)
+        checksum ^= *data++;
+
+    return checksum;
+}
+
+quint32 ashStuff(const quint8 *data, quint32 length, quint8 *output)
+{
+    quint32 start = 0, count = 0;
+
+    Q_UNUSED(tablesReady);
+
+    for (quint32 i = 0; i < length; i++)
+    {
+        if (!(ashTable[data[i]] & ASH_BYTE_RESERVED))
+            continue;
+
+        memcpy(output + count, data + start, i - start);
+        count += i - start;
+
+        output[count++] = ASH_ESCAPE_BYTE;
+        output[count++] = data[i] ^ ASH_ESCAPE_MASK;
+
+        start = i + 1;
+    }
+
+    memcpy(output + count, data + start, length - start);
+    return count + length - start;
+}
+
+bool ashUnstuff(const quint8 *data, quint32 length, quint8 *output, quint32 &count)
+{
+    quint32 start = 0;
+    bool escape = false;
+
+    Q_UNUSED(tablesReady);
+    count = 0;
+
+    for (quint32 i = 0; i < length; i++)
+    {
+        quint8 byte = data[i];
+
+        if (!escape && !(ashTable[byte] & ASH_BYTE_CONTROL))
+            continue;
+
+        memmove(output + count, data + start, i - start);
+        count += i - start;
+        start = i + 1;
+
+        switch (byte)
+        {
+            case 0x11: case 0x13: continue;
+            case 0x1A: count = 0; escape = false; continue;
+            case ASH_ESCAPE_BYTE: escape = true; continue;
+        }
+
+        if (!(ashTable[byte ^= ASH_ESCAPE_MASK] & ASH_BYTE_RESERVED))
+        {
+            count = i;
+            return false;
+        }
+
+        output[count++] = byte;
+        escape = false;
+    }
+
+    memmove(output + count, data + start, length - start);
+    count += length - start;
+
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#define ASH_ESCAPE_BYTE                 0x7D
+#define ASH_ESCAPE_MASK                 0x20
+
+#include <QtGlobal>
+
+quint16 crcCCITT(const quint8 *data, quint32 length, quint16 crc = 0xFFFF);
+quint16 crcKermit(const quint8 *data, quint32 length, quint16 crc = 0x0000);
+quint8 xorChecksum(const quint8 *data, quint32 length, quint8 checksum = 0x00);
+
+quint32 ashStuff(const quint8 *data, quint32 length, quint8 *output);
+bool ashUnstuff(const quint8 *data, quint32 length, quint8 *output, quint32 &count);
+
+#endif
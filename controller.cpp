@@ -206,7 +206,7 @@ void Controller::updateAvailability(void)
 
         it.value()->setAvailability(it.value()->active() ? time - it.value()->lastSeen() <= timeout ? Availability::Online : Availability::Offline : Availability::Inactive);
 
-        if (it.value()->availability() == check && m_lastSeen.value(it.value()->ieeeAddress()) == it.value()->lastSeen())
+        if (it.value()->availability() == check && m_lastSeen.value(it.key()) == it.value()->lastSeen())
             continue;
 
         json = {{"lastSeen", it.value()->lastSeen()}, {"status", it.value()->availability() == Availability::Online ? "online" : "offline"}};
@@ -215,7 +215,7 @@ void Controller::updateAvailability(void)
             json.insert("otaProgress", round(it.value()->otaData().progress()));
 
         mqttPublish(mqttTopic("device/%1/%2").arg(serviceTopic(), m_zigbee->devices()->names() ? it.value()->name() : it.value()->ieeeAddress().toHex(':')), json, true);
-        m_lastSeen.insert(it.value()->ieeeAddress(), it.value()->lastSeen());
+        m_lastSeen.insert(it.key(), it.value()->lastSeen());
     }
 }
 
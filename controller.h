@@ -50,7 +50,7 @@ private:
     QString m_haPrefix, m_haStatus;
     bool m_haEnabled, m_networkStarted;
 
-    QMap <QByteArray, qint64> m_lastSeen;
+    QMap <quint64, qint64> m_lastSeen;
 
     void publishExposes(DeviceObject *device, bool remove = false);
     void serviceOnline(void);
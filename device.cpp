@@ -133,20 +133,56 @@ void DeviceList::storeProperties(void)
 
 Device DeviceList::byName(const QString &name)
 {
-    for (auto it = begin(); it != end(); it++)
-        if (it.value()->name() == name)
-            return it.value();
-
-    return value(QByteArray::fromHex(name.toUtf8()));
+    Device device = m_nameIndex.value(name);
+    return device.isNull() ? value(deviceKey(QByteArray::fromHex(name.toUtf8()))) : device;
 }
 
 Device DeviceList::byNetwork(quint16 networkAddress)
 {
-    for (auto it = begin(); it != end(); it++)
-        if (it.value()->networkAddress() == networkAddress)
-            return it.value();
+    return m_networkIndex.value(networkAddress);
+}
 
-    return Device();
+void DeviceList::addDevice(const Device &device)
+{
+    auto it = find(deviceKey(device->ieeeAddress()));
+
+    if (it != end())
+        eraseDevice(it.value());
+
+    insert(deviceKey(device->ieeeAddress()), device);
+    m_nameIndex.insert(device->name(), device);
+    m_networkIndex.insert(device->networkAddress(), device);
+}
+
+void DeviceList::eraseDevice(const Device &device)
+{
+    Device copy = device;
+
+    if (m_nameIndex.value(copy->name()) == copy)
+        m_nameIndex.remove(copy->name());
+
+    if (m_networkIndex.value(copy->networkAddress()) == copy)
+        m_networkIndex.remove(copy->networkAddress());
+
+    remove(deviceKey(copy->ieeeAddress()));
+}
+
+void DeviceList::setName(const Device &device, const QString &name)
+{
+    if (m_nameIndex.value(device->name()) == device)
+        m_nameIndex.remove(device->name());
+
+    device->setName(name);
+    m_nameIndex.insert(name, device);
+}
+
+void DeviceList::setNetworkAddress(const Device &device, quint16 networkAddress)
+{
+    if (m_networkIndex.value(device->networkAddress()) == device)
+        m_networkIndex.remove(device->networkAddress());
+
+    device->setNetworkAddress(networkAddress);
+    m_networkIndex.insert(networkAddress, device);
 }
 
 Endpoint DeviceList::endpoint(const Device &device, quint8 endpointId)
@@ -272,7 +308,9 @@ void DeviceList::setupDevice(const Device &device)
 
         it.value()->timer()->stop();
         it.value()->properties().clear();
+        it.value()->clusterProperties().clear();
         it.value()->actions().clear();
+        it.value()->namedActions().clear();
         it.value()->reportings().clear();
         it.value()->polls().clear();
         it.value()->exposes().clear();
@@ -374,6 +412,8 @@ void DeviceList::setupDevice(const Device &device)
         device->setDescription(QString("%1/%2").arg(device->manufacturerName(), device->modelName()));
         recognizeDevice(device);
     }
+
+    setupIndexes(device);
 }
 
 void DeviceList::setupEndpoint(const Endpoint &endpoint, const QJsonObject &json, bool multiple)
@@ -928,7 +968,68 @@ void DeviceList::removeDevice(const Device &device)
         return;
     }
 
-    remove(device->ieeeAddress());
+    eraseDevice(device);
+}
+
+void DeviceList::setupIndexes(const Device &device)
+{
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    {
+        QList <QString> names = {QString()};
+
+        it.value()->clusterProperties().clear();
+        it.value()->namedActions().clear();
+
+        for (int i = 0; i < it.value()->properties().count(); i++)
+        {
+            const Property &property = it.value()->properties().at(i);
+
+            property->updateOptions();
+
+            for (int j = 0; j < property->clusters().count(); j++)
+            {
+                QList <Property> &list = it.value()->clusterProperties()[property->clusters().at(j)];
+
+                if (list.contains(property))
+                    continue;
+
+                list.append(property);
+            }
+        }
+
+        for (int i = 0; i < it.value()->actions().count(); i++)
+        {
+            const Action &action = it.value()->actions().at(i);
+
+            if (!names.contains(action->name()))
+                names.append(action->name());
+
+            for (int j = 0; j < action->actions().count(); j++)
+                if (!names.contains(action->actions().at(j)))
+                    names.append(action->actions().at(j));
+        }
+
+        for (int i = 0; i < names.count(); i++)
+        {
+            const QString &name = names.at(i);
+            QList <Action> list;
+
+            for (int j = 0; j < it.value()->actions().count(); j++)
+            {
+                const Action &action = it.value()->actions().at(j);
+
+                if (action->name() != name && action->name() != "tuyaDataPoints" && !action->actions().contains(name))
+                    continue;
+
+                list.append(action);
+            }
+
+            if (list.isEmpty())
+                continue;
+
+            it.value()->namedActions().insert(name, list);
+        }
+    }
 }
 
 void DeviceList::unserializeDevices(const QJsonArray &devices)
@@ -1040,7 +1141,7 @@ void DeviceList::unserializeDevices(const QJsonArray &devices)
                 count++;
             }
 
-            insert(device->ieeeAddress(), device);
+            addDevice(device);
         }
     }
 
@@ -1121,6 +1222,9 @@ QJsonArray DeviceList::serializeDevices(void)
             if (device->linkQuality())
                 json.insert("linkQuality", device->linkQuality());
 
+            if (!device->requests().isEmpty())
+                json.insert("requestQueue", device->requests().count());
+
             if (device->version())
                 json.insert("version", device->version());
 
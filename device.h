@@ -9,6 +9,7 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QtEndian>
 #include "action.h"
 #include "adapter.h"
 #include "binding.h"
@@ -128,7 +129,9 @@ public:
     inline void setUpdated(bool value) { m_updated = value; }
 
     inline QList <Property> &properties(void) { return m_properties; }
+    inline QHash <quint16, QList <Property>> &clusterProperties(void) { return m_clusterProperties; }
     inline QList <Action> &actions(void) { return m_actions; }
+    inline QHash <QString, QList <Action>> &namedActions(void) { return m_namedActions; }
     inline QList <Binding> &bindings(void) { return m_bindings; }
     inline QList <Reporting> &reportings(void) { return m_reportings; }
     inline QList <Poll> &polls(void) { return m_polls; }
@@ -149,7 +152,9 @@ private:
     bool m_updated;
 
     QList <Property> m_properties;
+    QHash <quint16, QList <Property>> m_clusterProperties;
     QList <Action> m_actions;
+    QHash <QString, QList <Action>> m_namedActions;
     QList <Binding> m_bindings;
     QList <Reporting> m_reportings;
     QList <Poll> m_polls;
@@ -211,6 +216,7 @@ public:
 
     inline OTAData &otaData(void) { return m_otaData; }
     inline QMap <quint16, quint8> &neighbors(void) { return m_neighbors; }
+    inline QQueue <quint16> &requests(void) { return m_requests; }
 
 private:
 
@@ -234,10 +240,11 @@ private:
 
     OTAData m_otaData;
     QMap <quint16, quint8> m_neighbors;
+    QQueue <quint16> m_requests;
 
 };
 
-class DeviceList : public QObject, public QMap <QByteArray, Device>
+class DeviceList : public QObject, public QMap <quint64, Device>
 {
     Q_OBJECT
 
@@ -246,6 +253,8 @@ public:
     DeviceList(QSettings *config, QObject *parent);
     ~DeviceList(void);
 
+    static inline quint64 deviceKey(const QByteArray &ieeeAddress) { return ieeeAddress.length() == 8 ? qFromBigEndian <quint64> (ieeeAddress.constData()) : 0; }
+
     inline QDir otaDir(void) { return m_otaDir; }
 
     inline bool names(void) { return m_names; }
@@ -260,6 +269,11 @@ public:
 
     Device byName(const QString &name);
     Device byNetwork(quint16 networkAddress);
+
+    void addDevice(const Device &device);
+    void eraseDevice(const Device &device);
+    void setName(const Device &device, const QString &name);
+    void setNetworkAddress(const Device &device, quint16 networkAddress);
     Endpoint endpoint(const Device &device, quint8 endpointId);
 
     void identityHandler(const Device &device, QString &manufacturerName, QString &modelName);
@@ -284,6 +298,11 @@ private:
     QMap <QString, QVariant> m_exposeOptions;
     QList <QString> m_specialExposes, m_brokenFiles;
 
+    QHash <QString, Device> m_nameIndex;
+    QHash <quint16, Device> m_networkIndex;
+
+    void setupIndexes(const Device &device);
+
     void unserializeDevices(const QJsonArray &devices);
     void unserializeProperties(const QJsonObject &properties);
 
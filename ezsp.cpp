@@ -1,30 +1,11 @@
 #include <QtEndian>
 #include <QRandomGenerator>
+#include "checksum.h"
 #include "ezsp.h"
 #include "logger.h"
 #include "zcl.h"
 
-static const uint16_t crcTable[256] =
-{
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823, 0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A, 0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
-};
-
-EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_timer(new QTimer(this)), m_version(0), m_errorCount(0)
+EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_timer(new QTimer(this)), m_acknowledgeTimer(new QTimer(this)), m_version(0), m_sequenceId(0), m_frameId(0), m_acknowledgeId(0), m_retransmitCount(0), m_acknowledgePending(false), m_rejectCondition(false), m_errorCount(0)
 {
     m_watchdog = config->value("zigbee/watchdog", true).toBool();
 
@@ -50,8 +31,15 @@ EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_time
     m_values.append({EZSP_VALUE_CCA_THRESHOLD,                      1, qToLittleEndian <quint16> (0x0000)});
     m_values.append({EZSP_VALUE_TRANSIENT_DEVICE_TIMEOUT,           2, qToLittleEndian <quint16> (0x2710)});
 
+    m_congestionStatus = {EZSP_STATUS_NO_BUFFERS, EZSP_STATUS_MAC_TRANSMIT_QUEUE_FULL, EZSP_STATUS_MAX_MESSAGE_LIMIT_REACHED};
+    m_deliveryStatus = {EZSP_STATUS_MAC_NO_ACK_RECEIVED, EZSP_STATUS_DELIVERY_FAILED};
+    m_macStatus = {EZSP_STATUS_MAC_NO_ACK_RECEIVED};
+
     connect(m_timer, &QTimer::timeout, this, &EZSP::resetManufacturerCode);
+    connect(m_acknowledgeTimer, &QTimer::timeout, this, &EZSP::retransmitFrames);
+
     m_timer->setSingleShot(true);
+    m_acknowledgeTimer->setSingleShot(true);
 }
 
 bool EZSP::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -64,7 +52,7 @@ bool EZSP::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointI
     request.clusterId = qToLittleEndian(clusterId);
     request.srcEndpointId = srcEndPointId;
     request.dstEndpointId = dstEndPointId;
-    request.options = qToLittleEndian <quint16> (EZSP_APS_OPTION_RETRY | EZSP_APS_OPTION_ENABLE_ROUTE_DISCOVERY | EZSP_APS_OPTION_ENABLE_ADDRESS_DISCOVERY);
+    request.options = qToLittleEndian <quint16> (EZSP_APS_OPTION_RETRY | (m_routeDiscovery ? EZSP_APS_OPTION_FORCE_ROUTE_DISCOVERY : EZSP_APS_OPTION_ENABLE_ROUTE_DISCOVERY) | EZSP_APS_OPTION_ENABLE_ADDRESS_DISCOVERY);
     request.groupId = 0x0000;
     request.sequence = id;
     request.tag = id;
@@ -162,29 +150,37 @@ void EZSP::resetInterPanChannel(void)
 
 quint16 EZSP::getCRC(quint8 *data, quint32 length)
 {
-    quint16 crc = 0xFFFF;
+    return qToBigEndian(crcCCITT(data, length));
+}
 
-    while (length--)
-        crc = static_cast <quint16> (crc << 8) ^ crcTable[(crc >> 8) ^ *data++];
+void EZSP::randomize(quint8 *data, int length)
+{
+    quint8 byte = 0x42;
 
-    return qToBigEndian(crc);
+    while (length--)
+    {
+        *data++ ^= byte;
+        byte = byte & 0x01 ? (byte >> 1) ^ 0xB8 : byte >> 1;
+    }
 }
 
-void EZSP::randomize(QByteArray &payload)
+quint16 EZSP::getConfig(quint8 id)
 {
-    quint8 *buffer = reinterpret_cast <quint8*> (payload.data()), byte = 0x42;
+    quint16 value;
 
-    for (int i = 0; i < payload.length(); i++)
+    if (!sendFrame(EZSP_FRAME_GET_CONFIG, QByteArray(1, static_cast <char> (id))) || m_replyStatus || m_replyData.length() != 3)
     {
-        buffer[i] ^= byte;
-        byte = byte & 0x01 ? (byte >> 1) ^ 0xB8 : byte >> 1;
+        logWarning << "Get config" << QString::asprintf("0x%02x", id) << "request failed";
+        return 0;
     }
+
+    memcpy(&value, m_replyData.constData() + 1, sizeof(value));
+    return qFromLittleEndian(value);
 }
 
 bool EZSP::sendFrame(quint16 frameId, const QByteArray &data, bool version)
 {
     QByteArray payload;
-    quint8 control = (m_sequenceId & 0x07) << 4 | m_acknowledgeId;
 
     if (version)
     {
@@ -205,26 +201,28 @@ bool EZSP::sendFrame(quint16 frameId, const QByteArray &data, bool version)
         payload.append(reinterpret_cast <char*> (&header), sizeof(header));
     }
 
-    randomize(payload.append(data));
+    payload.append(data);
+    randomize(reinterpret_cast <quint8*> (payload.data()), payload.length());
 
-    for (quint8 i = 0; i < ASH_REQUEST_RETRIES; i++)
+    if (m_frames.count() >= ASH_WINDOW_SIZE && !waitForSignal(this, SIGNAL(windowUpdated()), ASH_REQUEST_TIMEOUT))
     {
-        m_replyStatus = 0xFF;
-        m_replyData.clear();
-        m_replyReceived = false;
-
-        sendRequest(control, payload);
+        logWarning << "ASH transmit window is full";
+        m_errorCount++;
+        return false;
+    }
 
-        if (waitForSignal(this, SIGNAL(dataReceived()), ASH_REQUEST_TIMEOUT) && m_replyReceived)
-        {
-            m_errorCount = 0;
-            return true;
-        }
+    m_replyStatus = 0xFF;
+    m_replyData.clear();
+    m_replyReceived = false;
 
-        if (m_errorReceived)
-            break;
+    m_frames.insert(m_frameId, payload);
+    transmitFrame(m_frameId);
+    m_frameId = (m_frameId + 1) & 0x07;
 
-        control |= 0x08;
+    if (waitForSignal(this, SIGNAL(dataReceived()), ASH_REQUEST_TIMEOUT * ASH_REQUEST_RETRIES) && m_replyReceived)
+    {
+        m_errorCount = 0;
+        return true;
     }
 
     m_errorCount++;
@@ -235,6 +233,49 @@ bool EZSP::sendFrame(quint16 frameId, const QByteArray &data, bool version)
     return false;
 }
 
+void EZSP::transmitFrame(quint8 frameId, bool retransmit)
+{
+    sendRequest(frameId << 4 | (retransmit ? 0x08 : 0x00) | m_acknowledgeId, m_frames.value(frameId));
+    m_acknowledgePending = false;
+
+    if (m_acknowledgeTimer->isActive())
+        return;
+
+    m_acknowledgeTimer->start(ASH_ACKNOWLEDGE_TIMEOUT);
+}
+
+void EZSP::acknowledgeFrames(quint8 acknowledgeId)
+{
+    quint8 frameId = (m_frameId - m_frames.count()) & 0x07;
+
+    if (m_frames.isEmpty() || ((acknowledgeId - frameId) & 0x07) > m_frames.count() || acknowledgeId == frameId)
+        return;
+
+    while (frameId != acknowledgeId)
+    {
+        m_frames.remove(frameId);
+        frameId = (frameId + 1) & 0x07;
+    }
+
+    m_retransmitCount = 0;
+
+    if (m_frames.isEmpty())
+        m_acknowledgeTimer->stop();
+    else
+        m_acknowledgeTimer->start(ASH_ACKNOWLEDGE_TIMEOUT);
+
+    emit windowUpdated();
+}
+
+void EZSP::sendAcknowledge(void)
+{
+    if (!m_acknowledgePending)
+        return;
+
+    sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
+    m_acknowledgePending = false;
+}
+
 void EZSP::sendRequest(quint8 control, const QByteArray &payload)
 {
     QByteArray request, buffer;
@@ -246,19 +287,8 @@ void EZSP::sendRequest(quint8 control, const QByteArray &payload)
     crc = getCRC(reinterpret_cast <quint8*> (request.data()), request.length());
     request.append(reinterpret_cast <char*> (&crc), sizeof(crc));
 
-    for (int i = 0; i < request.length(); i++)
-    {
-        switch (request.at(i))
-        {
-            case 0x11: buffer.append(0x7D).append(0x31); break;
-            case 0x13: buffer.append(0x7D).append(0x33); break;
-            case 0x18: buffer.append(0x7D).append(0x38); break;
-            case 0x1A: buffer.append(0x7D).append(0x3A); break;
-            case 0x7D: buffer.append(0x7D).append(0x5D); break;
-            case 0x7E: buffer.append(0x7D).append(0x5E); break;
-            default:   buffer.append(request.at(i)); break;
-        }
-    }
+    buffer.resize(request.length() * 2 + 1);
+    buffer.resize(ashStuff(reinterpret_cast <const quint8*> (request.constData()), request.length(), reinterpret_cast <quint8*> (buffer.data())));
 
     m_errorReceived = false;
     sendData(buffer.append(static_cast <char> (ASH_PACKET_FLAG)));
@@ -486,6 +516,7 @@ bool EZSP::startCoordinator(void)
     ezspNetworkParametersStruct network;
     ezspVersionStruct version;
     quint64 ieeeAddress;
+    quint16 messageCount, bufferCount;
     bool check = false;
 
     if (!sendFrame(EZSP_FRAME_VERSION, QByteArray(), true))
@@ -541,6 +572,14 @@ bool EZSP::startCoordinator(void)
         logWarning << "Set config" << QString::asprintf("0x%02x", request.id) << "request failed";
     }
 
+    messageCount = getConfig(EZSP_CONFIG_APS_UNICAST_MESSAGE_COUNT);
+    bufferCount = getConfig(EZSP_CONFIG_PACKET_BUFFER_COUNT);
+
+    if (messageCount)
+        m_requestLimit = static_cast <quint8> (qBound <quint16> (1, bufferCount ? qMin(messageCount, bufferCount) : messageCount, 0xFF));
+
+    logInfo << "Adapter request limit is" << m_requestLimit << "with" << messageCount << "APS unicast messages and" << bufferCount << "packet buffers";
+
     for (int i = 0; i < m_policy.length(); i++)
     {
         ezspSetConfigStruct request = m_policy.at(i);
@@ -718,63 +757,43 @@ void EZSP::softReset(void)
 
 void EZSP::parseData(QByteArray &buffer)
 {
-    while (!buffer.isEmpty())
-    {
-        quint16 length, crc;
-        QByteArray packet;
+    char *data = buffer.data();
+    int offset = 0, end;
 
-        if (buffer.startsWith(QByteArray::fromHex("1ac102")) || buffer.startsWith(QByteArray::fromHex("1ac202")))
-            buffer.remove(0, 1);
-
-        if (buffer.length() < 4 || !buffer.contains(static_cast <char> (ASH_PACKET_FLAG)))
-            return;
+    while ((end = buffer.indexOf(static_cast <char> (ASH_PACKET_FLAG), offset)) >= 0)
+    {
+        quint8 *packet = reinterpret_cast <quint8*> (data + offset);
+        quint32 length;
+        quint16 crc;
 
-        length = static_cast <quint16> (buffer.indexOf(ASH_PACKET_FLAG));
-        logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 1).toHex(':');
+        logDebug(m_portDebug) << "Frame received:" << QByteArray::fromRawData(data + offset, end - offset + 1).toHex(':');
 
-        for (int i = 0; i < length; i++)
+        if (!ashUnstuff(packet, end - offset, packet, length))
         {
-            if (buffer.at(i) == 0x11 || buffer.at(i) == 0x13)
-                continue;
-
-            if (buffer.at(i) != 0x7D)
-            {
-                packet.append(buffer.at(i));
-                continue;
-            }
-
-            switch (buffer.at(++i))
-            {
-                case 0x31: packet.append(0x11); break;
-                case 0x33: packet.append(0x13); break;
-                case 0x38: packet.append(0x18); break;
-                case 0x3A: packet.append(0x1A); break;
-                case 0x5D: packet.append(0x7D); break;
-                case 0x5E: packet.append(0x7E); break;
-
-                default:
+            handleError(QString("Frame %1 unstaffing failed at position %2").arg(QString(QByteArray(data + offset, end - offset + 1).toHex(':'))).arg(length));
+            return;
+        }
 
-                    if (buffer.at(i) != 0x11 && buffer.at(i) != 0x13)
-                    {
-                        handleError(QString("Frame %1 unstaffing failed at position %2").arg(QString(buffer.mid(0, length + 1).toHex(':'))).arg(i));
-                        return;
-                    }
+        offset = end + 1;
 
-                    break;
-            }
-        }
+        if (length < 3)
+            continue;
 
-        memcpy(&crc, packet.constData() + packet.length() - 2, sizeof(crc));
+        memcpy(&crc, packet + length - 2, sizeof(crc));
 
-        if (crc != getCRC(reinterpret_cast <quint8*> (packet.data()), packet.length() - 2))
+        if (crc != getCRC(packet, length - 2))
         {
-            handleError(QString("Packet %1 CRC mismatch").arg(QString(packet.toHex(':'))));
+            handleError(QString("Packet %1 CRC mismatch").arg(QString(QByteArray(reinterpret_cast <char*> (packet), length).toHex(':'))));
             return;
         }
 
-        m_queue.enqueue(packet);
-        buffer.remove(0, length + 1);
+        if (!(packet[0] & 0x80))
+            randomize(packet + 1, length - 3);
+
+        m_queue.enqueue(QByteArray(reinterpret_cast <char*> (packet), length));
     }
+
+    buffer.remove(0, offset);
 }
 
 bool EZSP::permitJoin(bool enabled)
@@ -814,6 +833,29 @@ void EZSP::resetManufacturerCode(void)
     setManufacturerCode(MANUFACTURER_CODE_SILABS);
 }
 
+void EZSP::retransmitFrames(void)
+{
+    quint8 frameId = (m_frameId - m_frames.count()) & 0x07;
+
+    if (m_frames.isEmpty())
+        return;
+
+    if (++m_retransmitCount > ASH_REQUEST_RETRIES)
+    {
+        logWarning << "ASH frames are not acknowledged after" << ASH_REQUEST_RETRIES << "retransmissions";
+        m_frameId = frameId;
+        m_frames.clear();
+        m_retransmitCount = 0;
+        emit windowUpdated();
+        return;
+    }
+
+    for (int i = 0; i < m_frames.count(); i++)
+        transmitFrame((frameId + i) & 0x07, true);
+
+    m_acknowledgeTimer->start(ASH_ACKNOWLEDGE_TIMEOUT);
+}
+
 void EZSP::handleQueue(void)
 {
     while (!m_queue.isEmpty())
@@ -823,35 +865,61 @@ void EZSP::handleQueue(void)
 
         if (!(control & 0x80))
         {
-            QByteArray payload = packet.mid(1, packet.length() - 3);
+            quint8 frameId = (control >> 4) & 0x07;
 
-            m_acknowledgeId = ((control >> 4) + 1) & 0x07;
-            sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
+            acknowledgeFrames(control & 0x07);
 
-            randomize(payload);
-            parsePacket(payload);
+            if (frameId != m_acknowledgeId)
+            {
+                if (control & 0x08)
+                {
+                    m_acknowledgePending = true;
+                    continue;
+                }
+
+                if (!m_rejectCondition)
+                {
+                    logDebug(m_adapterDebug) << "Received out of sequence frame:" << QString::asprintf("%d, %d", m_acknowledgeId, frameId).toUtf8().constData();
+                    sendRequest(ASH_CONTROL_NAK | m_acknowledgeId);
+                    m_rejectCondition = true;
+                }
 
+                continue;
+            }
+
+            m_acknowledgeId = (frameId + 1) & 0x07;
+            m_acknowledgePending = true;
+            m_rejectCondition = false;
+
+            parsePacket(QByteArray::fromRawData(packet.constData() + 1, packet.length() - 3));
             continue;
         }
 
         if ((control & 0xE0) == ASH_CONTROL_ACK)
         {
-            m_replyReceived = true;
-            emit dataReceived();
+            acknowledgeFrames(control & 0x07);
             continue;
         }
 
         if ((control & 0xE0) == ASH_CONTROL_NAK)
         {
             logDebug(m_adapterDebug) << "Received NAK frame:" << QString::asprintf("%d, %d", m_acknowledgeId, control & 0x07).toUtf8().constData();
-            emit dataReceived();
-            break;
+            acknowledgeFrames(control & 0x07);
+            m_retransmitCount = 0;
+            retransmitFrames();
+            continue;
         }
 
         if (control == ASH_CONTROL_RSTACK)
         {
             m_sequenceId = 0;
+            m_frameId = 0;
             m_acknowledgeId = 0;
+            m_acknowledgePending = false;
+            m_rejectCondition = false;
+
+            m_frames.clear();
+            m_acknowledgeTimer->stop();
 
             if (!startCoordinator())
             {
@@ -872,5 +940,6 @@ void EZSP::handleQueue(void)
         handleError(QString("Received unrecognized ASH frame:").arg(QString(packet.toHex(':'))));
     }
 
+    sendAcknowledge();
     m_queue.clear();
 }
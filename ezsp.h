@@ -3,6 +3,8 @@
 
 #define ASH_REQUEST_TIMEOUT                                 2000
 #define ASH_REQUEST_RETRIES                                 3
+#define ASH_ACKNOWLEDGE_TIMEOUT                             1600
+#define ASH_WINDOW_SIZE                                     7
 #define ASH_PACKET_FLAG                                     0x7E
 
 #define ASH_CONTROL_ACK                                     0x80
@@ -31,6 +33,7 @@
 #define EZSP_FRAME_MESSAGE_SENT_HANDLER                     0x003F
 #define EZSP_FRAME_INCOMING_MESSAGE_HANDLER                 0x0045
 #define EZSP_FRAME_MAC_FILTER_MATCH_MESSAGE_HANDLER         0x0046
+#define EZSP_FRAME_GET_CONFIG                               0x0052
 #define EZSP_FRAME_SET_CONFIG                               0x0053
 #define EZSP_FRAME_SET_POLICY                               0x0055
 #define EZSP_FRAME_SET_SOURCE_ROUTE_DISCOVERY_MODE          0x005A
@@ -51,6 +54,7 @@
 #define EZSP_FRAME_EXPORT_KEY                               0x0114
 
 #define EZSP_CONFIG_PACKET_BUFFER_COUNT                     0x01
+#define EZSP_CONFIG_APS_UNICAST_MESSAGE_COUNT               0x03
 #define EZSP_CONFIG_STACK_PROFILE                           0x0C
 #define EZSP_CONFIG_SECURITY_LEVEL                          0x0D
 #define EZSP_CONFIG_INDIRECT_TRANSMISSION_TIMEOUT           0x12
@@ -96,10 +100,17 @@
 
 #define EZSP_APS_OPTION_RETRY                               0x0040
 #define EZSP_APS_OPTION_ENABLE_ROUTE_DISCOVERY              0x0100
+#define EZSP_APS_OPTION_FORCE_ROUTE_DISCOVERY               0x0200
 #define EZSP_APS_OPTION_ENABLE_ADDRESS_DISCOVERY            0x1000
 
 #define EZSP_NETWORK_STATUS_JOINED                          0x02
 
+#define EZSP_STATUS_NO_BUFFERS                              0x18
+#define EZSP_STATUS_MAC_TRANSMIT_QUEUE_FULL                 0x39
+#define EZSP_STATUS_MAC_NO_ACK_RECEIVED                     0x40
+#define EZSP_STATUS_DELIVERY_FAILED                         0x66
+#define EZSP_STATUS_MAX_MESSAGE_LIMIT_REACHED               0x72
+
 #include "adapter.h"
 
 #pragma pack(push, 1)
@@ -323,9 +334,11 @@ public:
 
 private:
 
-    QTimer *m_timer;
-    quint8 m_version, m_stackStatus, m_sequenceId, m_acknowledgeId;
-    bool m_watchdog;
+    QTimer *m_timer, *m_acknowledgeTimer;
+    quint8 m_version, m_stackStatus, m_sequenceId, m_frameId, m_acknowledgeId, m_retransmitCount;
+    bool m_watchdog, m_acknowledgePending, m_rejectCondition;
+
+    QMap <quint8, QByteArray> m_frames;
 
     QByteArray m_replyData;
     quint8 m_errorCount;
@@ -335,10 +348,15 @@ private:
     QList <ezspSetValueStruct> m_values;
 
     quint16 getCRC(quint8 *data, quint32 length);
-    void randomize(QByteArray &data);
+    void randomize(quint8 *data, int length);
 
     bool sendFrame(quint16 frameId, const QByteArray &data = QByteArray(), bool version = false);
+    quint16 getConfig(quint8 id);
     void sendRequest(quint8 control, const QByteArray &payload = QByteArray());
+    void sendAcknowledge(void);
+
+    void transmitFrame(quint8 frameId, bool retransmit = false);
+    void acknowledgeFrames(quint8 acknowledgeId);
     void parsePacket(const QByteArray &payload);
 
     bool startNetwork(quint64 extendedPanId);
@@ -354,11 +372,13 @@ private:
 private slots:
 
     void resetManufacturerCode(void);
+    void retransmitFrames(void);
     void handleQueue(void) override;
 
 signals:
 
     void dataReceived(void);
+    void windowUpdated(void);
     void stackStatusReceived(void);
 
 };
@@ -14,6 +14,7 @@ HEADERS += \
     actions/tuya.h \
     adapter.h \
     binding.h \
+    checksum.h \
     controller.h \
     device.h \
     ezsp.h \
@@ -27,6 +28,7 @@ HEADERS += \
     properties/tuya.h \
     property.h \
     reporting.h \
+    transport.h \
     zcl.h \
     zigate.h \
     zigbee.h \
@@ -44,6 +46,7 @@ SOURCES += \
     actions/tuya.cpp \
     adapter.cpp \
     binding.cpp \
+    checksum.cpp \
     controller.cpp \
     device.cpp \
     ezsp.cpp \
@@ -57,6 +60,7 @@ SOURCES += \
     properties/tuya.cpp \
     property.cpp \
     reporting.cpp \
+    transport.cpp \
     zcl.cpp \
     zigate.cpp \
     zigbee.cpp \
@@ -191,6 +191,7 @@ namespace Properties
 
         Humidity(void) : PropertyObject("humidity", CLUSTER_HUMIDITY_MEASUREMENT) {}
         void parseAttribte(quint16 clusterId, quint16 attributeId, const QByteArray &data) override;
+        void updateOptions(void) override;
 
     };
 
@@ -250,7 +250,7 @@ void PropertiesTUYA::CoverMotor::update(quint8 dataPoint, const QVariant &data)
 
     if (dataPoint == 0x02 || dataPoint == 0x03)
     {
-        quint8 value = static_cast <quint8> (option("invertCover").toBool() ? data.toInt() : 100 - data.toInt());
+        quint8 value = static_cast <quint8> (m_options.invertCover ? data.toInt() : 100 - data.toInt());
         map.insert("cover", value ? "open" : "closed");
         map.insert("position", static_cast <quint8> (value));
     }
@@ -268,9 +268,9 @@ void PropertiesTUYA::CoverSwitch::parseAttribte(quint16, quint16 attributeId, co
 
             switch (data.at(0))
             {
-                case 0: map.insert("event", option("invertCover").toBool() ? "close" : "open"); break;
+                case 0: map.insert("event", m_options.invertCover ? "close" : "open"); break;
                 case 1: map.insert("event", "stop"); break;
-                case 2: map.insert("event", option("invertCover").toBool() ? "open" : "close"); break;
+                case 2: map.insert("event", m_options.invertCover ? "open" : "close"); break;
             }
 
             break;
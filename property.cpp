@@ -110,6 +110,16 @@ void PropertyObject::registerMetaTypes(void)
     qRegisterMetaType <PropertiesIKEA::ArrowAction>                 ("ikeaArrowActionProperty");
 }
 
+void PropertyObject::updateOptions(void)
+{
+    QMap <QString, QVariant> map = option().toMap();
+
+    m_options.invertCover = option("invertCover").toBool();
+    m_options.raw = map.value("raw").toBool();
+    m_options.undivided = map.value("undivided").toBool();
+    m_options.divider = option(QString(m_name).append("Divider"), 1).toDouble();
+}
+
 quint8 PropertyObject::percentage(double min, double max, double value)
 {
     if (value < min)
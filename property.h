@@ -12,6 +12,14 @@ struct PropertyRequest
     QByteArray data;
 };
 
+struct PropertyOptions
+{
+    bool invertCover;
+    bool raw;
+    bool undivided;
+    double divider;
+};
+
 class PropertyObject;
 typedef QSharedPointer <PropertyObject> Property;
 
@@ -21,15 +29,16 @@ class PropertyObject : public AbstractMetaObject
 public:
 
     PropertyObject(const QString &name, QList <quint16> clusters = {}) :
-        AbstractMetaObject(name), m_clusters(clusters), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0) {}
+        AbstractMetaObject(name), m_clusters(clusters), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0), m_options({false, false, false, 1}) {}
 
     PropertyObject(const QString &name, quint16 clusterId) :
-        AbstractMetaObject(name), m_clusters({clusterId}), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0) {}
+        AbstractMetaObject(name), m_clusters({clusterId}), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0), m_options({false, false, false, 1}) {}
 
     virtual ~PropertyObject(void) {}
     virtual void parseAttribte(quint16, quint16, const QByteArray &) {}
     virtual void parseCommand(quint16, quint8, const QByteArray &) {}
     virtual void resetValue(void) {}
+    virtual void updateOptions(void);
 
     inline QList <quint16> &clusters(void) { return m_clusters; }
 
@@ -64,6 +73,7 @@ protected:
     QVariant m_value;
 
     QQueue <PropertyRequest> m_queue;
+    PropertyOptions m_options;
 
     quint8 percentage(double min, double max, double value);
     QVariant enumValue(const QString &name, int index);
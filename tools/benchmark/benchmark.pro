@@ -0,0 +1,14 @@
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = homed-zigbee-benchmark
+INCLUDEPATH += ../..
+
+HEADERS += \
+    ../../checksum.h
+
+SOURCES += \
+    ../../checksum.cpp \
+    main.cpp
@@ -0,0 +1,255 @@
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include <stdio.h>
+#include <string.h>
+#include "checksum.h"
+
+#define BENCHMARK_ITERATIONS            200000
+#define BENCHMARK_LOOKUPS               20000
+#define BENCHMARK_BUFFER_SIZE           1024
+
+struct BenchmarkDevice
+{
+    QString name;
+    quint16 networkAddress;
+};
+
+typedef QSharedPointer <BenchmarkDevice> Device;
+
+static quint16 ccittTable[256], kermitTable[256];
+static volatile quint32 sink;
+
+static void initTables(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        quint16 ccitt = static_cast <quint16> (i << 8), kermit = static_cast <quint16> (i);
+
+        for (int j = 0; j < 8; j++)
+        {
+            ccitt = ccitt & 0x8000 ? static_cast <quint16> (ccitt << 1) ^ 0x1021 : static_cast <quint16> (ccitt << 1);
+            kermit = kermit & 0x0001 ? (kermit >> 1) ^ 0x8408 : kermit >> 1;
+        }
+
+        ccittTable[i] = ccitt;
+        kermitTable[i] = kermit;
+    }
+}
+
+static quint16 bytewiseCCITT(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0xFFFF;
+
+    while (length--)
+        crc = static_cast <quint16> (crc << 8) ^ ccittTable[(crc >> 8) ^ *data++];
+
+    return crc;
+}
+
+static quint16 bytewiseKermit(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0x0000;
+
+    while (length--)
+        crc = static_cast <quint16> (crc >> 8) ^ kermitTable[(crc ^ *data++) & 0xFF];
+
+    return crc;
+}
+
+static quint8 bytewiseXor(const quint8 *data, quint32 length)
+{
+    quint8 checksum = 0;
+
+    while (length--)
+        checksum ^= *data++;
+
+    return checksum;
+}
+
+static quint32 bytewiseStuff(const quint8 *data, quint32 length, quint8 *output)
+{
+    quint32 count = 0;
+
+    for (quint32 i = 0; i < length; i++)
+    {
+        switch (data[i])
+        {
+            case 0x11: case 0x13: case 0x18: case 0x1A: case 0x7D: case 0x7E: output[count++] = 0x7D; output[count++] = data[i] ^ 0x20; break;
+            default: output[count++] = data[i]; break;
+        }
+    }
+
+    return count;
+}
+
+static bool bytewiseUnstuff(const quint8 *data, quint32 length, quint8 *output, quint32 &count)
+{
+    bool escape = false;
+
+    count = 0;
+
+    for (quint32 i = 0; i < length; i++)
+    {
+        quint8 byte = data[i];
+
+        switch (byte)
+        {
+            case 0x11: case 0x13: continue;
+            case 0x1A: count = 0; escape = false; continue;
+            case 0x7D: escape = true; continue;
+        }
+
+        if (escape)
+        {
+            switch (byte ^= 0x20)
+            {
+                case 0x11: case 0x13: case 0x18: case 0x1A: case 0x7D: case 0x7E: break;
+
+                default:
+                    count = i;
+                    return false;
+            }
+
+            escape = false;
+        }
+
+        output[count++] = byte;
+    }
+
+    return true;
+}
+
+static Device linearNetwork(const QMap <QByteArray, Device> &devices, quint16 networkAddress)
+{
+    for (auto it = devices.begin(); it != devices.end(); it++)
+        if (it.value()->networkAddress == networkAddress)
+            return it.value();
+
+    return Device();
+}
+
+static Device linearName(const QMap <QByteArray, Device> &devices, const QString &name)
+{
+    for (auto it = devices.begin(); it != devices.end(); it++)
+        if (it.value()->name == name)
+            return it.value();
+
+    return Device();
+}
+
+template <typename T> static double measure(T function, int iterations = BENCHMARK_ITERATIONS)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+
+    for (int i = 0; i < iterations; i++)
+        sink = sink + function();
+
+    return static_cast <double> (timer.nsecsElapsed()) / iterations;
+}
+
+static void report(const char *name, quint32 count, const char *unit, double reference, double current, bool match)
+{
+    printf("%-16s %6u %-7s %10.1f ns %10.1f ns %8.2fx %s\n", name, count, unit, reference, current, reference / current, match ? "ok" : "MISMATCH");
+}
+
+static bool benchmarkChecksums(const quint8 *data, const quint32 *sizes, int count)
+{
+    static quint8 reference[BENCHMARK_BUFFER_SIZE * 2], current[BENCHMARK_BUFFER_SIZE * 2];
+    bool result = true;
+
+    printf("%-16s %14s %13s %13s %9s\n", "kernel", "length", "bytewise", "current", "speedup");
+
+    for (int i = 0; i < count; i++)
+    {
+        quint32 length = sizes[i], referenceLength, currentLength;
+        bool match;
+
+        match = bytewiseCCITT(data, length) == crcCCITT(data, length);
+        report("crcCCITT", length, "bytes", measure([&] () { return bytewiseCCITT(data, length); }), measure([&] () { return crcCCITT(data, length); }), match);
+        result &= match;
+
+        match = bytewiseKermit(data, length) == crcKermit(data, length);
+        report("crcKermit", length, "bytes", measure([&] () { return bytewiseKermit(data, length); }), measure([&] () { return crcKermit(data, length); }), match);
+        result &= match;
+
+        match = bytewiseXor(data, length) == xorChecksum(data, length);
+        report("xorChecksum", length, "bytes", measure([&] () { return bytewiseXor(data, length); }), measure([&] () { return xorChecksum(data, length); }), match);
+        result &= match;
+
+        referenceLength = bytewiseStuff(data, length, reference);
+        currentLength = ashStuff(data, length, current);
+        match = referenceLength == currentLength && !memcmp(reference, current, currentLength);
+        report("ashStuff", length, "bytes", measure([&] () { return bytewiseStuff(data, length, reference); }), measure([&] () { return ashStuff(data, length, current); }), match);
+        result &= match;
+
+        referenceLength = bytewiseStuff(data, length, reference);
+        match = ashUnstuff(reference, referenceLength, current, currentLength) && currentLength == length && !memcmp(current, data, length);
+        report("ashUnstuff", length, "bytes", measure([&] () { return bytewiseUnstuff(reference, referenceLength, current, currentLength) ? currentLength : 0; }), measure([&] () { return ashUnstuff(reference, referenceLength, current, currentLength) ? currentLength : 0; }), match);
+        result &= match;
+    }
+
+    return result;
+}
+
+static bool benchmarkLookups(const quint32 *sizes, int count)
+{
+    bool result = true;
+
+    printf("\n%-16s %14s %13s %13s %9s\n", "lookup", "devices", "linear", "hash", "speedup");
+
+    for (int i = 0; i < count; i++)
+    {
+        QMap <QByteArray, Device> devices;
+        QHash <QString, Device> nameIndex;
+        QHash <quint16, Device> networkIndex;
+        QList <Device> list;
+        quint32 index = 0;
+        bool match = true;
+
+        for (quint32 j = 0; j < sizes[i]; j++)
+        {
+            Device device(new BenchmarkDevice);
+            quint64 ieeeAddress = 0x00124B0000000000 + j * 0x9E3779B1;
+
+            device->name = QString("device_%1").arg(j);
+            device->networkAddress = static_cast <quint16> (j * 40503 + 1);
+
+            devices.insert(QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)), device);
+            nameIndex.insert(device->name, device);
+            networkIndex.insert(device->networkAddress, device);
+            list.append(device);
+        }
+
+        for (int j = 0; j < list.count(); j++)
+            match &= linearNetwork(devices, list.at(j)->networkAddress) == networkIndex.value(list.at(j)->networkAddress) && linearName(devices, list.at(j)->name) == nameIndex.value(list.at(j)->name);
+
+        report("byNetwork", sizes[i], "devices", measure([&] () { return linearNetwork(devices, list.at(index++ % list.count())->networkAddress).isNull(); }, BENCHMARK_LOOKUPS), measure([&] () { return networkIndex.value(list.at(index++ % list.count())->networkAddress).isNull(); }, BENCHMARK_LOOKUPS), match);
+        report("byName", sizes[i], "devices", measure([&] () { return linearName(devices, list.at(index++ % list.count())->name).isNull(); }, BENCHMARK_LOOKUPS), measure([&] () { return nameIndex.value(list.at(index++ % list.count())->name).isNull(); }, BENCHMARK_LOOKUPS), match);
+        result &= match;
+    }
+
+    return result;
+}
+
+int main(void)
+{
+    quint32 sizes[] = {8, 32, 128, 512, BENCHMARK_BUFFER_SIZE}, devices[] = {10, 100, 1000, 5000}, seed = 0x12345678;
+    quint8 data[BENCHMARK_BUFFER_SIZE];
+    bool result = true;
+
+    initTables();
+
+    for (int i = 0; i < BENCHMARK_BUFFER_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = static_cast <quint8> (seed >> 16);
+    }
+
+    result &= benchmarkChecksums(data, sizes, sizeof(sizes) / sizeof(sizes[0]));
+    result &= benchmarkLookups(devices, sizeof(devices) / sizeof(devices[0]));
+    return result ? 0 : 1;
+}
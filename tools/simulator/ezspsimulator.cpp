@@ -0,0 +1,363 @@
+#include <QtEndian>
+#include "checksum.h"
+#include "ezspsimulator.h"
+
+static void randomize(quint8 *data, int length)
+{
+    quint8 byte = 0x42;
+
+    while (length--)
+    {
+        *data++ ^= byte;
+        byte = byte & 0x01 ? (byte >> 1) ^ 0xB8 : byte >> 1;
+    }
+}
+
+EZSPSimulator::EZSPSimulator(const QString &link, quint32 devices, quint32 rate, quint8 version, quint8 channel, quint16 panId, const QByteArray &networkKey, QObject *parent) : Simulator(link, devices, rate, parent), m_version(version), m_frameId(0), m_acknowledgeId(0), m_ready(false), m_channel(channel), m_panId(panId), m_extendedPanId(qToLittleEndian <quint64> (EZSP_SIMULATOR_IEEE_ADDRESS)), m_networkKey(networkKey), m_joined(true)
+{
+    m_config.insert(EZSP_CONFIG_APS_UNICAST_MESSAGE_COUNT, EZSP_SIMULATOR_APS_UNICAST_MESSAGE_COUNT);
+    m_config.insert(EZSP_CONFIG_PACKET_BUFFER_COUNT, 0x00FF);
+}
+
+void EZSPSimulator::sendFrame(quint8 control, const QByteArray &payload)
+{
+    QByteArray request(1, static_cast <char> (control)), buffer;
+    quint16 crc;
+
+    request.append(payload);
+
+    if (!(control & 0x80))
+        randomize(reinterpret_cast <quint8*> (request.data() + 1), payload.length());
+
+    crc = qToBigEndian(crcCCITT(reinterpret_cast <const quint8*> (request.constData()), request.length()));
+    request.append(reinterpret_cast <char*> (&crc), sizeof(crc));
+
+    buffer.resize(request.length() * 2 + 1);
+    buffer.resize(ashStuff(reinterpret_cast <const quint8*> (request.constData()), request.length(), reinterpret_cast <quint8*> (buffer.data())));
+
+    sendData(buffer.append(static_cast <char> (ASH_PACKET_FLAG)));
+}
+
+void EZSPSimulator::sendPayload(const QByteArray &payload)
+{
+    sendFrame(static_cast <quint8> (m_frameId << 4 | m_acknowledgeId), payload);
+    m_frameId = (m_frameId + 1) & 0x07;
+}
+
+void EZSPSimulator::sendPacket(quint8 sequence, quint8 frameControl, quint16 frameId, const QByteArray &data)
+{
+    ezspHeaderStruct header;
+
+    header.sequence = sequence;
+    header.frameControlLow = frameControl;
+    header.frameControlHigh = 0x01;
+    header.frameId = qToLittleEndian(frameId);
+
+    sendPayload(QByteArray(reinterpret_cast <char*> (&header), sizeof(header)).append(data));
+}
+
+void EZSPSimulator::sendCallback(quint16 frameId, const QByteArray &data)
+{
+    sendPacket(0x00, EZSP_FRAME_CONTROL_CALLBACK, frameId, data);
+}
+
+QByteArray EZSPSimulator::networkParameters(void)
+{
+    ezspNetworkParametersStruct network;
+
+    memset(&network, 0, sizeof(network));
+
+    network.extendedPanId = m_extendedPanId;
+    network.panId = qToLittleEndian(m_panId);
+    network.txPower = 20;
+    network.channel = m_channel;
+    network.channelList = qToLittleEndian <quint32> (1 << m_channel);
+
+    return QByteArray(reinterpret_cast <char*> (&network), sizeof(network));
+}
+
+void EZSPSimulator::handlePacket(const QByteArray &payload)
+{
+    const ezspHeaderStruct *header = reinterpret_cast <const ezspHeaderStruct*> (payload.constData());
+    QByteArray data = payload.mid(sizeof(ezspHeaderStruct)), response(1, EZSP_STATUS_SUCCESS);
+    quint16 frameId, stackVersion = qToLittleEndian <quint16> (EZSP_SIMULATOR_STACK_VERSION);
+    quint8 stackStatus = 0x00;
+
+    if (payload.isEmpty())
+        return;
+
+    if (payload.length() < static_cast <int> (sizeof(ezspHeaderStruct)))
+    {
+        sendPayload(QByteArray(1, payload.at(0)).append(1, static_cast <char> (EZSP_FRAME_CONTROL_RESPONSE)).append(1, 0x00).append(1, static_cast <char> (m_version)).append(1, EZSP_SIMULATOR_STACK_TYPE).append(reinterpret_cast <char*> (&stackVersion), sizeof(stackVersion)));
+        return;
+    }
+
+    frameId = qFromLittleEndian(header->frameId);
+
+    switch (frameId)
+    {
+        case EZSP_FRAME_VERSION:
+        {
+            response = QByteArray(1, static_cast <char> (m_version)).append(1, EZSP_SIMULATOR_STACK_TYPE).append(reinterpret_cast <char*> (&stackVersion), sizeof(stackVersion));
+            break;
+        }
+
+        case EZSP_FRAME_GET_VALUE:
+        {
+            ezspVersionStruct version;
+
+            if (data.at(0) != EZSP_VALUE_VERSION_INFO)
+            {
+                response.append(1, 0x00);
+                break;
+            }
+
+            version.build = 0x0000;
+            version.major = EZSP_SIMULATOR_STACK_VERSION >> 12 & 0x0F;
+            version.minor = EZSP_SIMULATOR_STACK_VERSION >> 8 & 0x0F;
+            version.patch = EZSP_SIMULATOR_STACK_VERSION >> 4 & 0x0F;
+
+            response.append(1, sizeof(version) + 2).append(reinterpret_cast <char*> (&version), sizeof(version)).append(2, 0x00);
+            break;
+        }
+
+        case EZSP_FRAME_GET_IEEE_ADDRESS:
+        {
+            quint64 ieeeAddress = qToLittleEndian <quint64> (EZSP_SIMULATOR_IEEE_ADDRESS);
+            response = QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress));
+            break;
+        }
+
+        case EZSP_FRAME_SET_CONFIG:
+        {
+            const ezspSetConfigStruct *request = reinterpret_cast <const ezspSetConfigStruct*> (data.constData());
+            m_config.insert(request->id, qFromLittleEndian(request->value));
+            break;
+        }
+
+        case EZSP_FRAME_GET_CONFIG:
+        {
+            quint16 value = qToLittleEndian(m_config.value(static_cast <quint8> (data.at(0))));
+            response.append(reinterpret_cast <char*> (&value), sizeof(value));
+            break;
+        }
+
+        case EZSP_FRAME_SET_SOURCE_ROUTE_DISCOVERY_MODE:
+        {
+            response = QByteArray(4, 0x00);
+            break;
+        }
+
+        case EZSP_FRAME_NETWORK_INIT:
+        {
+            if (!m_joined)
+            {
+                response = QByteArray(1, static_cast <char> (EZSP_STATUS_NOT_JOINED));
+                break;
+            }
+
+            stackStatus = EZSP_STACK_STATUS_NETWORK_UP;
+            break;
+        }
+
+        case EZSP_FRAME_NETWORK_STATUS:
+        {
+            response = QByteArray(1, m_joined ? EZSP_NETWORK_STATUS_JOINED : EZSP_NETWORK_STATUS_NO_NETWORK);
+            break;
+        }
+
+        case EZSP_FRAME_GET_NETWORK_PARAMETERS:
+        {
+            response = QByteArray(1, static_cast <char> (m_joined ? EZSP_STATUS_SUCCESS : EZSP_STATUS_NOT_JOINED)).append(1, EZSP_NODE_TYPE_COORDINATOR).append(networkParameters());
+            break;
+        }
+
+        case EZSP_FRAME_LEAVE_NETWORK:
+        {
+            m_joined = false;
+            stackStatus = EZSP_STACK_STATUS_NETWORK_DOWN;
+            break;
+        }
+
+        case EZSP_FRAME_SET_INITIAL_SECURITY_STATE:
+        {
+            const ezspSetInitialSecurityStruct *request = reinterpret_cast <const ezspSetInitialSecurityStruct*> (data.constData());
+            m_networkKey = QByteArray(reinterpret_cast <const char*> (request->networkKey), sizeof(request->networkKey));
+            break;
+        }
+
+        case EZSP_FRAME_FORM_NERWORK:
+        {
+            const ezspNetworkParametersStruct *request = reinterpret_cast <const ezspNetworkParametersStruct*> (data.constData());
+
+            m_extendedPanId = request->extendedPanId;
+            m_panId = qFromLittleEndian(request->panId);
+            m_channel = request->channel;
+            m_joined = true;
+
+            stackStatus = EZSP_STACK_STATUS_NETWORK_UP;
+            break;
+        }
+
+        case EZSP_FRAME_GET_KEY:
+        {
+            response.append(2, 0x00).append(data.left(1)).append(m_networkKey).append(17, 0x00);
+            break;
+        }
+
+        case EZSP_FRAME_EXPORT_KEY:
+        {
+            response = QByteArray(m_networkKey).append(4, 0x00);
+            break;
+        }
+
+        case EZSP_FRAME_FIND_KEY_TABLE_ENTRY:
+        {
+            response = QByteArray(1, static_cast <char> (0xFF));
+            break;
+        }
+
+        case EZSP_FRAME_SET_MANUFACTURER_CODE:
+        {
+            if (m_ready)
+                break;
+
+            qInfo() << "Coordinator started, injecting device traffic";
+            m_ready = true;
+
+            startTraffic();
+            break;
+        }
+
+        case EZSP_FRAME_SEND_UNICAST:
+        {
+            const ezspSendUnicastStruct *request = reinterpret_cast <const ezspSendUnicastStruct*> (data.constData());
+            ezspMessageSentStruct message;
+
+            message.type = request->type;
+            message.networkAddress = request->networkAddress;
+            message.profileId = request->profileId;
+            message.clusterId = request->clusterId;
+            message.srcEndpointId = request->srcEndpointId;
+            message.dstEndpointId = request->dstEndpointId;
+            message.options = request->options;
+            message.groupId = request->groupId;
+            message.sequence = request->sequence;
+            message.tag = request->tag;
+            message.status = EZSP_STATUS_SUCCESS;
+            message.length = 0;
+
+            sendPacket(header->sequence, EZSP_FRAME_CONTROL_RESPONSE, frameId, response.append(1, static_cast <char> (request->sequence)));
+            sendCallback(EZSP_FRAME_MESSAGE_SENT_HANDLER, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)));
+
+            deviceRequest(qFromLittleEndian(request->networkAddress), qFromLittleEndian(request->profileId), qFromLittleEndian(request->clusterId), request->dstEndpointId, data.mid(sizeof(ezspSendUnicastStruct), request->length));
+            return;
+        }
+
+        case EZSP_FRAME_SEND_MULTICAST:
+        {
+            const ezspSendMulticastStruct *request = reinterpret_cast <const ezspSendMulticastStruct*> (data.constData());
+            ezspMessageSentStruct message;
+
+            memset(&message, 0, sizeof(message));
+
+            message.type = EZSP_MESSAGE_TYPE_MULTICAST;
+            message.profileId = request->profileId;
+            message.clusterId = request->clusterId;
+            message.srcEndpointId = request->srcEndpointId;
+            message.dstEndpointId = request->dstEndpointId;
+            message.options = request->options;
+            message.groupId = request->groupId;
+            message.sequence = request->sequence;
+            message.tag = request->tag;
+            message.status = EZSP_STATUS_SUCCESS;
+
+            sendPacket(header->sequence, EZSP_FRAME_CONTROL_RESPONSE, frameId, response.append(1, static_cast <char> (request->sequence)));
+            sendCallback(EZSP_FRAME_MESSAGE_SENT_HANDLER, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)));
+            return;
+        }
+    }
+
+    sendPacket(header->sequence, EZSP_FRAME_CONTROL_RESPONSE, frameId, response);
+
+    if (!stackStatus)
+        return;
+
+    sendCallback(EZSP_FRAME_STACK_STATUS_HANDLER, QByteArray(1, static_cast <char> (stackStatus)));
+}
+
+void EZSPSimulator::parseData(QByteArray &buffer)
+{
+    int end;
+
+    while ((end = buffer.indexOf(static_cast <char> (ASH_PACKET_FLAG))) >= 0)
+    {
+        QByteArray frame = buffer.left(end);
+        quint32 length;
+        quint16 crc;
+        quint8 control;
+
+        buffer.remove(0, end + 1);
+
+        if (!ashUnstuff(reinterpret_cast <quint8*> (frame.data()), frame.length(), reinterpret_cast <quint8*> (frame.data()), length) || length < 3)
+            continue;
+
+        memcpy(&crc, frame.constData() + length - 2, sizeof(crc));
+
+        if (qFromBigEndian(crc) != crcCCITT(reinterpret_cast <const quint8*> (frame.constData()), length - 2))
+        {
+            qWarning() << "Frame" << frame.left(length).toHex(':') << "CRC mismatch";
+            continue;
+        }
+
+        control = static_cast <quint8> (frame.at(0));
+
+        if (control == ASH_CONTROL_RST)
+        {
+            stopTraffic();
+
+            m_frameId = 0;
+            m_acknowledgeId = 0;
+            m_ready = false;
+
+            sendFrame(ASH_CONTROL_RSTACK, QByteArray(1, ASH_VERSION).append(1, ASH_RESET_SOFTWARE));
+            continue;
+        }
+
+        if (control & 0x80)
+            continue;
+
+        if ((control >> 4 & 0x07) != m_acknowledgeId)
+        {
+            sendFrame(ASH_CONTROL_ACK | m_acknowledgeId);
+            continue;
+        }
+
+        m_acknowledgeId = (m_acknowledgeId + 1) & 0x07;
+
+        randomize(reinterpret_cast <quint8*> (frame.data() + 1), length - 3);
+        handlePacket(frame.mid(1, length - 3));
+    }
+}
+
+void EZSPSimulator::sendMessage(const simulatorDeviceStruct &device, quint16 profileId, quint16 clusterId, quint8 endpointId, const QByteArray &payload)
+{
+    ezspIncomingMessageStruct message;
+
+    message.type = EZSP_MESSAGE_TYPE_DIRECT;
+    message.profileId = qToLittleEndian(profileId);
+    message.clusterId = qToLittleEndian(clusterId);
+    message.srcEndpointId = endpointId;
+    message.dstEndpointId = endpointId ? 0x01 : 0x00;
+    message.options = 0x0000;
+    message.groupId = 0x0000;
+    message.sequence = device.transactionId;
+    message.linkQuality = 0xFF;
+    message.rssi = static_cast <quint8> (-40);
+    message.networkAddress = qToLittleEndian(device.networkAddress);
+    message.bindingIndex = 0xFF;
+    message.addressIndex = 0xFF;
+    message.length = static_cast <quint8> (payload.length());
+
+    sendCallback(EZSP_FRAME_INCOMING_MESSAGE_HANDLER, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(payload));
+}
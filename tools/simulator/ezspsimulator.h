@@ -0,0 +1,59 @@
+#ifndef EZSPSIMULATOR_H
+#define EZSPSIMULATOR_H
+
+#define EZSP_SIMULATOR_STACK_TYPE                           0x02
+#define EZSP_SIMULATOR_STACK_VERSION                        0x7410
+#define EZSP_SIMULATOR_IEEE_ADDRESS                         0x00124B0001020304
+#define EZSP_SIMULATOR_APS_UNICAST_MESSAGE_COUNT            10
+
+#define ASH_VERSION                                         0x02
+#define ASH_RESET_SOFTWARE                                  0x0B
+
+#define EZSP_FRAME_CONTROL_RESPONSE                         0x80
+#define EZSP_FRAME_CONTROL_CALLBACK                         0x90
+
+#define EZSP_STATUS_SUCCESS                                 0x00
+#define EZSP_STATUS_NOT_JOINED                              0x93
+#define EZSP_NETWORK_STATUS_NO_NETWORK                      0x00
+#define EZSP_NODE_TYPE_COORDINATOR                          0x01
+
+#define EZSP_MESSAGE_TYPE_MULTICAST                         0x03
+
+#include "ezsp.h"
+#include "simulator.h"
+
+class EZSPSimulator : public Simulator
+{
+    Q_OBJECT
+
+public:
+
+    EZSPSimulator(const QString &link, quint32 devices, quint32 rate, quint8 version, quint8 channel, quint16 panId, const QByteArray &networkKey, QObject *parent = nullptr);
+
+private:
+
+    quint8 m_version, m_frameId, m_acknowledgeId;
+    bool m_ready;
+
+    quint8 m_channel;
+    quint16 m_panId;
+    quint64 m_extendedPanId;
+    QByteArray m_networkKey;
+    bool m_joined;
+
+    QMap <quint8, quint16> m_config;
+
+    void sendFrame(quint8 control, const QByteArray &payload = QByteArray());
+    void sendPayload(const QByteArray &payload);
+    void sendPacket(quint8 sequence, quint8 frameControl, quint16 frameId, const QByteArray &data);
+    void sendCallback(quint16 frameId, const QByteArray &data);
+
+    QByteArray networkParameters(void);
+    void handlePacket(const QByteArray &payload);
+
+    void parseData(QByteArray &buffer) override;
+    void sendMessage(const simulatorDeviceStruct &device, quint16 profileId, quint16 clusterId, quint8 endpointId, const QByteArray &payload) override;
+
+};
+
+#endif
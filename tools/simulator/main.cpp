@@ -0,0 +1,38 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include "ezspsimulator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCommandLineParser parser;
+    Simulator *simulator;
+
+    parser.addHelpOption();
+    parser.addOptions(
+    {
+        {"adapter",  "Adapter protocol to simulate (ezsp).", "type", "ezsp"},
+        {"link",     "Symlink created for the pseudo-terminal slave.", "path"},
+        {"devices",  "Number of virtual devices.", "count", "10"},
+        {"rate",     "Attribute reports per second across all devices.", "count", "10"},
+        {"version",  "EZSP protocol version.", "version", "13"},
+        {"channel",  "Formed network channel.", "channel", "11"},
+        {"panid",    "Formed network PAN ID.", "panid", "0x1010"},
+        {"key",      "Formed network key.", "key", "000102030405060708090a0b0c0d0e0f"}
+    });
+
+    parser.process(application);
+
+    if (parser.value("adapter") != "ezsp")
+    {
+        qWarning() << "Unsupported adapter type" << parser.value("adapter");
+        return 1;
+    }
+
+    simulator = new EZSPSimulator(parser.value("link"), parser.value("devices").toUInt(), parser.value("rate").toUInt(), static_cast <quint8> (parser.value("version").toUInt()), static_cast <quint8> (parser.value("channel").toUInt()), static_cast <quint16> (parser.value("panid").toUInt(nullptr, 16)), QByteArray::fromHex(parser.value("key").remove("0x").toUtf8()), &application);
+
+    if (!simulator->open())
+        return 1;
+
+    return application.exec();
+}
@@ -0,0 +1,298 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include "adapter.h"
+#include "simulator.h"
+#include "zcl.h"
+
+Simulator::Simulator(const QString &link, quint32 devices, quint32 rate, QObject *parent) : QObject(parent), m_link(link), m_master(-1), m_slave(-1), m_notifier(nullptr), m_announceTimer(new QTimer(this)), m_reportTimer(new QTimer(this)), m_statusTimer(new QTimer(this)), m_rate(rate), m_reports(0), m_requests(0)
+{
+    for (quint32 i = 0; i < devices; i++)
+    {
+        quint16 networkAddress = static_cast <quint16> (SIMULATOR_NETWORK_ADDRESS + i);
+        m_devices.insert(networkAddress, {SIMULATOR_IEEE_ADDRESS + i, networkAddress, 0, 2000});
+    }
+
+    connect(m_announceTimer, &QTimer::timeout, this, &Simulator::announceTimeout);
+    connect(m_reportTimer, &QTimer::timeout, this, &Simulator::reportTimeout);
+    connect(m_statusTimer, &QTimer::timeout, this, &Simulator::statusTimeout);
+
+    m_statusTimer->start(SIMULATOR_STATUS_INTERVAL);
+}
+
+Simulator::~Simulator(void)
+{
+    if (!m_link.isEmpty())
+        QFile::remove(m_link);
+
+    if (m_slave >= 0)
+        ::close(m_slave);
+
+    if (m_master >= 0)
+        ::close(m_master);
+}
+
+bool Simulator::open(void)
+{
+    struct termios options;
+    QString name;
+
+    m_master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (m_master < 0 || grantpt(m_master) || unlockpt(m_master))
+    {
+        qWarning() << "Pseudo-terminal create error";
+        return false;
+    }
+
+    name = ptsname(m_master);
+    m_slave = ::open(name.toUtf8().constData(), O_RDWR | O_NOCTTY);
+
+    if (m_slave < 0 || tcgetattr(m_slave, &options))
+    {
+        qWarning() << "Pseudo-terminal" << name << "open error";
+        return false;
+    }
+
+    cfmakeraw(&options);
+    tcsetattr(m_slave, TCSANOW, &options);
+    fcntl(m_master, F_SETFL, fcntl(m_master, F_GETFL) | O_NONBLOCK);
+
+    if (!m_link.isEmpty())
+    {
+        QFile::remove(m_link);
+
+        if (!QFile::link(name, m_link))
+        {
+            qWarning() << "Link" << m_link << "create error";
+            return false;
+        }
+    }
+
+    m_notifier = new QSocketNotifier(m_master, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &Simulator::readyRead);
+
+    qInfo() << "Simulator port is" << (m_link.isEmpty() ? name : QString("%1 (%2)").arg(m_link, name)).toUtf8().constData() << "with" << m_devices.count() << "devices";
+    return true;
+}
+
+void Simulator::sendData(const QByteArray &data)
+{
+    if (::write(m_master, data.constData(), data.length()) == data.length())
+        return;
+
+    qWarning() << "Pseudo-terminal write error, data dropped";
+}
+
+void Simulator::startTraffic(void)
+{
+    if (m_announceTimer->isActive() || m_reportTimer->isActive())
+        return;
+
+    m_announce = m_devices.begin();
+    m_announceTimer->start(SIMULATOR_ANNOUNCE_INTERVAL);
+}
+
+void Simulator::stopTraffic(void)
+{
+    m_announceTimer->stop();
+    m_reportTimer->stop();
+}
+
+void Simulator::deviceRequest(quint16 networkAddress, quint16 profileId, quint16 clusterId, quint8 endpointId, const QByteArray &payload)
+{
+    auto it = m_devices.find(networkAddress);
+    QByteArray response;
+
+    if (it == m_devices.end() || payload.isEmpty())
+        return;
+
+    m_requests++;
+
+    if (!profileId)
+    {
+        sendMessage(it.value(), 0x0000, clusterId | 0x8000, 0x00, zdoResponse(it.value(), clusterId, payload));
+        return;
+    }
+
+    response = zclResponse(it.value(), clusterId, payload);
+
+    if (response.isEmpty())
+        return;
+
+    sendMessage(it.value(), profileId, clusterId, endpointId, response);
+}
+
+QByteArray Simulator::attributeValue(const simulatorDeviceStruct &device, quint16 clusterId, quint16 attributeId)
+{
+    switch (clusterId << 16 | attributeId)
+    {
+        case CLUSTER_BASIC << 16 | 0x0001: return QByteArray(1, DATA_TYPE_8BIT_UNSIGNED).append(1, 0x01);
+        case CLUSTER_BASIC << 16 | 0x0004: return QByteArray(1, DATA_TYPE_CHARACTER_STRING).append(1, static_cast <char> (strlen(SIMULATOR_MANUFACTURER_NAME))).append(SIMULATOR_MANUFACTURER_NAME);
+        case CLUSTER_BASIC << 16 | 0x0005: return QByteArray(1, DATA_TYPE_CHARACTER_STRING).append(1, static_cast <char> (strlen(SIMULATOR_MODEL_NAME))).append(SIMULATOR_MODEL_NAME);
+        case CLUSTER_BASIC << 16 | 0x0007: return QByteArray(1, DATA_TYPE_8BIT_ENUM).append(1, 0x01);
+        case CLUSTER_BASIC << 16 | 0x4000: return QByteArray(1, DATA_TYPE_CHARACTER_STRING).append(1, static_cast <char> (strlen(SIMULATOR_FIRMWARE))).append(SIMULATOR_FIRMWARE);
+
+        case CLUSTER_TEMPERATURE_MEASUREMENT << 16 | 0x0000:
+        {
+            qint16 value = qToLittleEndian(device.temperature);
+            return QByteArray(1, DATA_TYPE_16BIT_SIGNED).append(reinterpret_cast <char*> (&value), sizeof(value));
+        }
+    }
+
+    return QByteArray();
+}
+
+QByteArray Simulator::zdoResponse(const simulatorDeviceStruct &device, quint16 clusterId, const QByteArray &payload)
+{
+    QByteArray response(1, payload.at(0));
+
+    switch (clusterId)
+    {
+        case ZDO_NODE_DESCRIPTOR_REQUEST:
+        {
+            nodeDescriptorResponseStruct descriptor;
+
+            memset(&descriptor, 0, sizeof(descriptor));
+
+            descriptor.networkAddress = qToLittleEndian(device.networkAddress);
+            descriptor.logicalType = 0x01;
+            descriptor.capabilityFlags = 0x8E;
+            descriptor.manufacturerCode = qToLittleEndian <quint16> (SIMULATOR_MANUFACTURER_CODE);
+            descriptor.maxBufferSize = 0x52;
+            descriptor.maxTransferSize = qToLittleEndian <quint16> (0x0052);
+            descriptor.maxOutTransferSize = qToLittleEndian <quint16> (0x0052);
+
+            return response.append(reinterpret_cast <char*> (&descriptor), sizeof(descriptor));
+        }
+
+        case ZDO_SIMPLE_DESCRIPTOR_REQUEST:
+        {
+            QList <quint16> clusters = {CLUSTER_BASIC, CLUSTER_TEMPERATURE_MEASUREMENT};
+            simpleDescriptorResponseStruct descriptor;
+            QByteArray data(1, static_cast <char> (clusters.count()));
+
+            for (int i = 0; i < clusters.count(); i++)
+            {
+                quint16 clusterId = qToLittleEndian(clusters.at(i));
+                data.append(reinterpret_cast <char*> (&clusterId), sizeof(clusterId));
+            }
+
+            data.append(1, 0x00);
+
+            descriptor.status = STATUS_SUCCESS;
+            descriptor.networkAddress = qToLittleEndian(device.networkAddress);
+            descriptor.length = static_cast <quint8> (sizeof(descriptor) - 4 + data.length());
+            descriptor.endpointId = 0x01;
+            descriptor.profileId = qToLittleEndian <quint16> (PROFILE_HA);
+            descriptor.deviceId = qToLittleEndian <quint16> (0x0302);
+            descriptor.version = 0x00;
+
+            return response.append(reinterpret_cast <char*> (&descriptor), sizeof(descriptor)).append(data);
+        }
+
+        case ZDO_ACTIVE_ENDPOINTS_REQUEST:
+        {
+            activeEndpointsResponseStruct endpoints;
+
+            endpoints.status = STATUS_SUCCESS;
+            endpoints.networkAddress = qToLittleEndian(device.networkAddress);
+            endpoints.count = 1;
+
+            return response.append(reinterpret_cast <char*> (&endpoints), sizeof(endpoints)).append(1, 0x01);
+        }
+    }
+
+    return response.append(1, STATUS_SUCCESS);
+}
+
+QByteArray Simulator::zclResponse(const simulatorDeviceStruct &device, quint16 clusterId, const QByteArray &payload)
+{
+    quint8 frameControl = static_cast <quint8> (payload.at(0)), offset = frameControl & FC_MANUFACTURER_SPECIFIC ? 3 : 1, transactionId, commandId;
+    QByteArray response;
+
+    if (payload.length() < offset + 2)
+        return QByteArray();
+
+    transactionId = static_cast <quint8> (payload.at(offset));
+    commandId = static_cast <quint8> (payload.at(offset + 1));
+
+    if (frameControl & FC_CLUSTER_SPECIFIC || commandId != CMD_READ_ATTRIBUTES)
+        return frameControl & FC_DISABLE_DEFAULT_RESPONSE ? QByteArray() : defaultResponse(transactionId, 0x0000, commandId, STATUS_SUCCESS);
+
+    response = zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_READ_ATTRIBUTES_RESPONSE);
+
+    for (int i = offset + 2; i + 1 < payload.length(); i += 2)
+    {
+        quint16 attributeId;
+        QByteArray value;
+
+        memcpy(&attributeId, payload.constData() + i, sizeof(attributeId));
+        value = attributeValue(device, clusterId, qFromLittleEndian(attributeId));
+
+        response.append(reinterpret_cast <char*> (&attributeId), sizeof(attributeId));
+        response.append(value.isEmpty() ? QByteArray(1, static_cast <char> (STATUS_UNSUPPORTED_ATTRIBUTE)) : QByteArray(1, STATUS_SUCCESS).append(value));
+    }
+
+    return response;
+}
+
+void Simulator::readyRead(void)
+{
+    char data[1024];
+    ssize_t length;
+
+    while ((length = ::read(m_master, data, sizeof(data))) > 0)
+        m_buffer.append(data, static_cast <int> (length));
+
+    parseData(m_buffer);
+}
+
+void Simulator::announceTimeout(void)
+{
+    deviceAnnounceStruct announce;
+
+    if (m_announce == m_devices.end())
+    {
+        m_announceTimer->stop();
+
+        if (!m_rate || m_devices.isEmpty())
+            return;
+
+        m_report = m_devices.begin();
+        m_reportTimer->start(qMax <quint32> (1000 / m_rate, 1));
+        return;
+    }
+
+    announce.networkAddress = qToLittleEndian(m_announce->networkAddress);
+    announce.ieeeAddress = qToLittleEndian(m_announce->ieeeAddress);
+    announce.capabilities = 0x8E;
+
+    sendMessage(m_announce.value(), 0x0000, ZDO_DEVICE_ANNOUNCE, 0x00, QByteArray(1, static_cast <char> (m_announce->transactionId++)).append(reinterpret_cast <char*> (&announce), sizeof(announce)));
+    m_announce++;
+}
+
+void Simulator::reportTimeout(void)
+{
+    for (quint32 i = 0; i < qMax <quint32> (m_rate / 1000, 1); i++)
+    {
+        quint16 attributeId = 0x0000;
+
+        m_report->temperature += static_cast <qint16> (QRandomGenerator::global()->bounded(-10, 11));
+        sendMessage(m_report.value(), PROFILE_HA, CLUSTER_TEMPERATURE_MEASUREMENT, 0x01, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, m_report->transactionId++, CMD_REPORT_ATTRIBUTES).append(reinterpret_cast <char*> (&attributeId), sizeof(attributeId)).append(attributeValue(m_report.value(), CLUSTER_TEMPERATURE_MEASUREMENT, attributeId)));
+
+        if (++m_report == m_devices.end())
+            m_report = m_devices.begin();
+
+        m_reports++;
+    }
+}
+
+void Simulator::statusTimeout(void)
+{
+    qInfo() << m_reports << "reports sent and" << m_requests << "device requests received";
+}
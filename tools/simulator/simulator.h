@@ -0,0 +1,75 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#define SIMULATOR_ANNOUNCE_INTERVAL     50
+#define SIMULATOR_STATUS_INTERVAL       10000
+#define SIMULATOR_NETWORK_ADDRESS       0x1000
+#define SIMULATOR_IEEE_ADDRESS          0x00124B00AA000000
+#define SIMULATOR_MANUFACTURER_CODE     0x1234
+#define SIMULATOR_MANUFACTURER_NAME     "HOMEd"
+#define SIMULATOR_MODEL_NAME            "Simulated Sensor"
+#define SIMULATOR_FIRMWARE              "1.0.0"
+
+#include <QDebug>
+#include <QMap>
+#include <QSocketNotifier>
+#include <QTimer>
+
+struct simulatorDeviceStruct
+{
+    quint64 ieeeAddress;
+    quint16 networkAddress;
+    quint8  transactionId;
+    qint16  temperature;
+};
+
+class Simulator : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Simulator(const QString &link, quint32 devices, quint32 rate, QObject *parent = nullptr);
+    ~Simulator(void);
+
+    bool open(void);
+
+protected:
+
+    QMap <quint16, simulatorDeviceStruct> m_devices;
+
+    void sendData(const QByteArray &data);
+    void startTraffic(void);
+    void stopTraffic(void);
+
+    void deviceRequest(quint16 networkAddress, quint16 profileId, quint16 clusterId, quint8 endpointId, const QByteArray &payload);
+
+private:
+
+    QString m_link;
+    int m_master, m_slave;
+
+    QSocketNotifier *m_notifier;
+    QTimer *m_announceTimer, *m_reportTimer, *m_statusTimer;
+
+    QByteArray m_buffer;
+    quint32 m_rate, m_reports, m_requests;
+    QMap <quint16, simulatorDeviceStruct>::iterator m_announce, m_report;
+
+    QByteArray attributeValue(const simulatorDeviceStruct &device, quint16 clusterId, quint16 attributeId);
+    QByteArray zdoResponse(const simulatorDeviceStruct &device, quint16 clusterId, const QByteArray &payload);
+    QByteArray zclResponse(const simulatorDeviceStruct &device, quint16 clusterId, const QByteArray &payload);
+
+    virtual void parseData(QByteArray &buffer) = 0;
+    virtual void sendMessage(const simulatorDeviceStruct &device, quint16 profileId, quint16 clusterId, quint8 endpointId, const QByteArray &payload) = 0;
+
+private slots:
+
+    void readyRead(void);
+    void announceTimeout(void);
+    void reportTimeout(void);
+    void statusTimeout(void);
+
+};
+
+#endif
@@ -0,0 +1,21 @@
+QT += network serialport
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = homed-zigbee-simulator
+INCLUDEPATH += ../..
+
+HEADERS += \
+    ../../checksum.h \
+    ../../zcl.h \
+    ezspsimulator.h \
+    simulator.h
+
+SOURCES += \
+    ../../checksum.cpp \
+    ../../zcl.cpp \
+    ezspsimulator.cpp \
+    main.cpp \
+    simulator.cpp
@@ -0,0 +1,208 @@
+#include <netinet/tcp.h>
+#include <QThread>
+#include "transport.h"
+
+int RingBuffer::space(void)
+{
+    return (m_tail.loadAcquire() - m_head.loadAcquire() - 1 + m_size) % m_size;
+}
+
+bool RingBuffer::write(const QByteArray &data)
+{
+    int head = m_head.loadAcquire(), length = qMin(data.length(), m_size - head);
+
+    if (data.length() > space())
+        return false;
+
+    memcpy(m_data.data() + head, data.constData(), length);
+    memcpy(m_data.data(), data.constData() + length, data.length() - length);
+
+    m_head.storeRelease((head + data.length()) % m_size);
+    return true;
+}
+
+QByteArray RingBuffer::read(void)
+{
+    int head = m_head.loadAcquire(), tail = m_tail.loadAcquire();
+    QByteArray data;
+
+    if (head == tail)
+        return data;
+
+    if (head > tail)
+        data = QByteArray(m_data.data() + tail, head - tail);
+    else
+        data = QByteArray(m_data.data() + tail, m_size - tail).append(m_data.data(), head);
+
+    m_tail.storeRelease(head);
+    return data;
+}
+
+Transport::Transport(const QString &portName, qint32 baudRate) : QObject(nullptr), m_serial(new QSerialPort(this)), m_socket(nullptr), m_port(0), m_noDelay(false), m_receiveBuffer(TRANSPORT_BUFFER_SIZE), m_transmitBuffer(TRANSPORT_BUFFER_SIZE), m_open(0), m_readPending(0), m_writePending(0), m_overflow(0), m_framesSent(0), m_writes(0), m_bytesSent(0), m_reads(0), m_bytesReceived(0)
+{
+    m_device = m_serial;
+
+    m_serial->setPortName(portName);
+    m_serial->setBaudRate(baudRate);
+    m_serial->setDataBits(QSerialPort::Data8);
+    m_serial->setParity(QSerialPort::NoParity);
+    m_serial->setStopBits(QSerialPort::OneStop);
+
+    connect(m_serial, &QSerialPort::readyRead, this, &Transport::readyRead);
+    connect(m_serial, &QSerialPort::errorOccurred, this, &Transport::serialError);
+}
+
+Transport::Transport(const QHostAddress &address, quint16 port, bool noDelay) : QObject(nullptr), m_serial(nullptr), m_socket(new QTcpSocket(this)), m_address(address), m_port(port), m_noDelay(noDelay), m_receiveBuffer(TRANSPORT_BUFFER_SIZE), m_transmitBuffer(TRANSPORT_BUFFER_SIZE), m_open(0), m_readPending(0), m_writePending(0), m_overflow(0), m_framesSent(0), m_writes(0), m_bytesSent(0), m_reads(0), m_bytesReceived(0)
+{
+    m_device = m_socket;
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &Transport::readyRead);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, &Transport::socketError);
+    connect(m_socket, &QTcpSocket::connected, this, &Transport::socketConnected);
+}
+
+QByteArray Transport::read(void)
+{
+    QByteArray data;
+
+    m_readPending.fetchAndStoreOrdered(0);
+    data = m_receiveBuffer.read();
+
+    if (m_overflow.fetchAndStoreOrdered(0))
+        QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
+
+    return data;
+}
+
+bool Transport::write(const QByteArray &data, quint32 frames)
+{
+    if (!m_transmitBuffer.write(data))
+        return false;
+
+    m_framesSent.fetchAndAddRelaxed(frames);
+
+    if (!m_writePending.fetchAndStoreOrdered(1))
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+
+    return true;
+}
+
+QJsonObject Transport::statistics(void)
+{
+    return {{"framesSent", static_cast <qint64> (m_framesSent.loadAcquire())}, {"writes", static_cast <qint64> (m_writes.loadAcquire())}, {"bytesSent", static_cast <qint64> (m_bytesSent.loadAcquire())}, {"reads", static_cast <qint64> (m_reads.loadAcquire())}, {"bytesReceived", static_cast <qint64> (m_bytesReceived.loadAcquire())}};
+}
+
+bool Transport::open(void)
+{
+    if (m_serial)
+    {
+        if (m_serial->isOpen())
+            m_serial->close();
+
+        m_open.storeRelease(m_serial->open(QIODevice::ReadWrite));
+        return m_open.loadAcquire();
+    }
+
+    if (m_socket->state() != QAbstractSocket::UnconnectedState)
+        m_socket->abort();
+
+    m_open.storeRelease(0);
+    m_socket->connectToHost(m_address, m_port);
+    return true;
+}
+
+void Transport::close(void)
+{
+    if (m_serial)
+        m_serial->close();
+    else
+        m_socket->disconnectFromHost();
+
+    m_open.storeRelease(0);
+}
+
+void Transport::reopen(int delay)
+{
+    close();
+    QThread::msleep(delay);
+    open();
+}
+
+void Transport::clear(void)
+{
+    m_device->readAll();
+    m_overflow.storeRelease(0);
+}
+
+void Transport::flowReset(int delay)
+{
+    if (!m_serial)
+        return;
+
+    m_serial->setRequestToSend(true);
+    m_serial->setDataTerminalReady(false);
+    QThread::msleep(delay);
+    m_serial->setRequestToSend(false);
+}
+
+void Transport::flush(void)
+{
+    QByteArray data;
+
+    m_writePending.fetchAndStoreOrdered(0);
+    data = m_transmitBuffer.read();
+
+    if (data.isEmpty())
+        return;
+
+    m_writes.fetchAndAddRelaxed(1);
+    m_bytesSent.fetchAndAddRelaxed(data.length());
+    m_device->write(data);
+}
+
+void Transport::readyRead(void)
+{
+    while (m_device->bytesAvailable())
+    {
+        int space = m_receiveBuffer.space();
+        QByteArray data;
+
+        if (!space)
+        {
+            m_overflow.fetchAndStoreOrdered(1);
+            break;
+        }
+
+        data = m_device->read(space);
+
+        m_reads.fetchAndAddRelaxed(1);
+        m_bytesReceived.fetchAndAddRelaxed(data.length());
+        m_receiveBuffer.write(data);
+    }
+
+    if (m_readPending.fetchAndStoreOrdered(1))
+        return;
+
+    emit dataReceived();
+}
+
+void Transport::socketConnected(void)
+{
+    int descriptor = m_socket->socketDescriptor(), keepAlive = 1, interval = 10, count = 3;
+
+    setsockopt(descriptor, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(keepAlive));
+    setsockopt(descriptor, SOL_TCP, TCP_KEEPIDLE, &interval, sizeof(interval));
+    setsockopt(descriptor, SOL_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(descriptor, SOL_TCP, TCP_KEEPCNT, &count, sizeof(count));
+
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, m_noDelay ? 1 : 0);
+
+    m_open.storeRelease(1);
+    emit connected();
+}
+
+void Transport::socketError(QTcpSocket::SocketError error)
+{
+    m_open.storeRelease(0);
+    emit connectionError(error);
+}
@@ -0,0 +1,90 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#define TRANSPORT_BUFFER_SIZE           65536
+
+#include <QAtomicInteger>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QScopedArrayPointer>
+#include <QSerialPort>
+#include <QTcpSocket>
+
+class RingBuffer
+{
+
+public:
+
+    RingBuffer(int size) : m_data(new char[size]), m_size(size), m_head(0), m_tail(0) {}
+
+    int space(void);
+    bool write(const QByteArray &data);
+    QByteArray read(void);
+
+private:
+
+    QScopedArrayPointer <char> m_data;
+    int m_size;
+
+    QAtomicInteger <int> m_head, m_tail;
+
+};
+
+class Transport : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Transport(const QString &portName, qint32 baudRate);
+    Transport(const QHostAddress &address, quint16 port, bool noDelay);
+
+    inline bool isOpen(void) { return m_open.loadAcquire(); }
+
+    QByteArray read(void);
+    bool write(const QByteArray &data, quint32 frames = 1);
+
+    QJsonObject statistics(void);
+
+private:
+
+    QSerialPort *m_serial;
+    QTcpSocket *m_socket;
+    QIODevice *m_device;
+
+    QHostAddress m_address;
+    quint16 m_port;
+    bool m_noDelay;
+
+    RingBuffer m_receiveBuffer, m_transmitBuffer;
+    QAtomicInteger <int> m_open, m_readPending, m_writePending, m_overflow;
+    QAtomicInteger <quint32> m_framesSent, m_writes, m_bytesSent, m_reads, m_bytesReceived;
+
+public slots:
+
+    bool open(void);
+    void close(void);
+    void reopen(int delay);
+
+    void clear(void);
+    void flowReset(int delay);
+
+private slots:
+
+    void flush(void);
+    void readyRead(void);
+
+    void socketConnected(void);
+    void socketError(QTcpSocket::SocketError error);
+
+signals:
+
+    void dataReceived(void);
+    void connected(void);
+
+    void serialError(QSerialPort::SerialPortError error);
+    void connectionError(QTcpSocket::SocketError error);
+
+};
+
+#endif
@@ -1,5 +1,5 @@
 #include <QtEndian>
-#include <QThread>
+#include "checksum.h"
 #include "logger.h"
 #include "zboss.h"
 
@@ -23,34 +23,19 @@ static uint8_t const crc8Table[256] =
     0xd0, 0xee, 0xac, 0x92, 0x28, 0x16, 0x54, 0x6a, 0x45, 0x7b, 0x39, 0x07, 0xbd, 0x83, 0xc1, 0xff
 };
 
-static uint16_t const crc16Table[256] =
+ZBoss::ZBoss(QSettings *config, QObject *parent) : Adapter(config, parent), m_clear(false), m_acknowledgeTimer(new QTimer(this)), m_sequenceId(0), m_acknowledgeId(0), m_retransmitCount(0)
 {
-    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf, 0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
-    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e, 0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
-    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd, 0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
-    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c, 0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
-    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb, 0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
-    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a, 0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
-    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9, 0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
-    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738, 0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
-    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7, 0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
-    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036, 0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
-    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5, 0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
-    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134, 0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
-    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3, 0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
-    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232, 0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
-    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1, 0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
-    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330, 0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
-};
+    m_congestionStatus = {ZBOSS_STATUS_NOT_ACKNOWLEDGED};
 
-ZBoss::ZBoss(QSettings *config, QObject *parent) : Adapter(config, parent), m_clear(false)
-{
     m_policy.append({ZBOSS_POLICY_TC_LINK_KEYS_REQUIRED,           0x00});
     m_policy.append({ZBOSS_POLICY_IC_REQUIRED,                     0x00});
     m_policy.append({ZBOSS_POLICY_TC_REJOIN_ENABLED,               0x01});
     m_policy.append({ZBOSS_POLICY_IGNORE_TC_REJOIN,                0x00});
     m_policy.append({ZBOSS_POLICY_APS_INSECURE_JOIN,               0x00});
     m_policy.append({ZBOSS_POLICY_DISABLE_NWK_MGMT_CHANNEL_UPDATE, 0x00});
+
+    connect(m_acknowledgeTimer, &QTimer::timeout, this, &ZBoss::retransmitFrame);
+    m_acknowledgeTimer->setSingleShot(true);
 }
 
 bool ZBoss::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -184,32 +169,20 @@ quint8 ZBoss::getCRC8(quint8 *data, quint32 length)
 
 quint16 ZBoss::getCRC16(quint8 *data, quint32 length)
 {
-    quint16 crc = 0x0000;
-
-    while (length--)
-        crc = static_cast <quint16> (crc >> 8) ^ crc16Table[(crc ^ *data++) & 0xFF];
-
-    return qToLittleEndian(crc);
+    return qToLittleEndian(crcKermit(data, length));
 }
 
 bool ZBoss::sendRequest(quint16 command, const QByteArray &data, quint8 id)
 {
-    zbossLowLevelHeaderStruct lowLevelHeader;
     zbossCommonHeaderStruct commonHeader;
     QByteArray payload;
-    quint16 crc;
+    bool idle = m_frames.isEmpty();
 
     logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%04x", command) << data.toHex(':');
 
     m_command = command;
     m_replyStatus = 0xFF;
 
-    lowLevelHeader.signature = qToBigEndian <quint16> (ZBOSS_SIGNATURE);
-    lowLevelHeader.length = data.length() + 12;
-    lowLevelHeader.type = ZBOSS_NCP_API_HL;
-    lowLevelHeader.flags = m_sequenceId << 2 | ZBOSS_FLAG_FIRST_FRAGMENT | ZBISS_FLAG_LAST_FRAGMENT;
-    lowLevelHeader.crc = getCRC8(reinterpret_cast <quint8*> (&lowLevelHeader) + 2, sizeof(lowLevelHeader) - 3);
-
     commonHeader.version = ZBOSS_PROTOCOL_VERSION;
     commonHeader.type = ZBOSS_TYPE_REQUEST;
     commonHeader.id = qToLittleEndian(command);
@@ -218,10 +191,39 @@ bool ZBoss::sendRequest(quint16 command, const QByteArray &data, quint8 id)
     payload.append(1, static_cast <char> (id));
     payload.append(data);
 
-    crc = getCRC16(reinterpret_cast <quint8*> (payload.data()), payload.length());
+    for (int offset = 0; offset < payload.length(); offset += ZBOSS_MAX_FRAGMENT_LENGTH)
+    {
+        quint8 flags = offset ? 0x00 : ZBOSS_FLAG_FIRST_FRAGMENT;
+
+        if (offset + ZBOSS_MAX_FRAGMENT_LENGTH >= payload.length())
+            flags |= ZBISS_FLAG_LAST_FRAGMENT;
+
+        m_frames.enqueue({id, flags, payload.mid(offset, ZBOSS_MAX_FRAGMENT_LENGTH)});
+    }
+
+    if (idle)
+        sendFrame();
+
+    if (command & 0x0200 && command != ZBOSS_ZDO_PERMIT_JOINING_REQ)
+        return true;
+
+    return waitForSignal(this, SIGNAL(dataReceived()), ZBOSS_REQUEST_TIMEOUT);
+}
+
+void ZBoss::sendFrame(bool retransmit)
+{
+    zbossLowLevelHeaderStruct lowLevelHeader;
+    QByteArray data = m_frames.head().data;
+    quint16 crc = getCRC16(reinterpret_cast <quint8*> (data.data()), data.length());
+
+    lowLevelHeader.signature = qToBigEndian <quint16> (ZBOSS_SIGNATURE);
+    lowLevelHeader.length = data.length() + 7;
+    lowLevelHeader.type = ZBOSS_NCP_API_HL;
+    lowLevelHeader.flags = m_sequenceId << 2 | m_frames.head().flags | (retransmit ? ZBOSS_FLAG_RETRANSMIT : 0x00);
+    lowLevelHeader.crc = getCRC8(reinterpret_cast <quint8*> (&lowLevelHeader) + 2, sizeof(lowLevelHeader) - 3);
 
-    sendData(QByteArray(reinterpret_cast <char*> (&lowLevelHeader), sizeof(lowLevelHeader)).append(reinterpret_cast <char*> (&crc), sizeof(crc)).append(payload));
-    return waitForSignal(this, command & 0x0200 && command != ZBOSS_ZDO_PERMIT_JOINING_REQ ? SIGNAL(acknowledgeReceived()) : SIGNAL(dataReceived()), ZBOSS_REQUEST_TIMEOUT);
+    sendData(QByteArray(reinterpret_cast <char*> (&lowLevelHeader), sizeof(lowLevelHeader)).append(reinterpret_cast <char*> (&crc), sizeof(crc)).append(data));
+    m_acknowledgeTimer->start(ZBOSS_ACKNOWLEDGE_TIMEOUT);
 }
 
 void ZBoss::sendAcknowledge(void)
@@ -237,14 +239,42 @@ void ZBoss::sendAcknowledge(void)
     sendData(QByteArray(reinterpret_cast <char*> (&lowLevelHeader), sizeof(lowLevelHeader)));
 }
 
+void ZBoss::acknowledgeFrame(quint8 sequenceId)
+{
+    if (m_frames.isEmpty() || sequenceId != m_sequenceId)
+        return;
+
+    m_frames.dequeue();
+    m_sequenceId = (m_sequenceId + 1) & 0x03;
+    m_retransmitCount = 0;
+    m_acknowledgeTimer->stop();
+
+    if (m_frames.isEmpty())
+        return;
+
+    sendFrame();
+}
+
+void ZBoss::clearFrames(void)
+{
+    m_frames.clear();
+    m_fragment.clear();
+    m_acknowledgeTimer->stop();
+    m_sequenceId = 0;
+    m_retransmitCount = 0;
+}
+
 void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
 {
     logDebug(m_adapterDebug) << "<--" << QString::asprintf("0x%04x", command) << data.toHex(':');
 
+    quint8 status = type == ZBOSS_TYPE_RESPONSE ? static_cast <quint8> (data.at(2)) : m_replyStatus;
+    QByteArray reply = data.mid(3);
+
     if (type == ZBOSS_TYPE_RESPONSE && command == m_command)
     {
-        m_replyStatus = static_cast <quint8> (data.at(2));
-        m_replyData = data.mid(3);
+        m_replyStatus = status;
+        m_replyData = reply;
         emit dataReceived();
     }
 
@@ -253,7 +283,7 @@ void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
         case ZBOSS_NCP_RESET:
         case ZBOSS_NCP_RESET_IND:
         {
-            m_sequenceId = 0;
+            clearFrames();
 
             if (!startCoordinator())
             {
@@ -267,13 +297,13 @@ void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
 
         case ZBOSS_ZDO_NODE_DESC_REQ:
         {
-            const zbossNodeDescriptorResponseStruct *message = reinterpret_cast <const zbossNodeDescriptorResponseStruct*> (m_replyData.constData());
+            const zbossNodeDescriptorResponseStruct *message = reinterpret_cast <const zbossNodeDescriptorResponseStruct*> (reply.constData());
             quint16 networkAddress;
             QByteArray payload;
 
-            memcpy(&networkAddress, m_replyData.mid(m_replyData.length() - sizeof(networkAddress)), sizeof(networkAddress));
+            memcpy(&networkAddress, reply.mid(reply.length() - sizeof(networkAddress)), sizeof(networkAddress));
 
-            payload.append(1, static_cast <char> (m_replyStatus));
+            payload.append(1, static_cast <char> (status));
             payload.append(reinterpret_cast <const char*> (&networkAddress), sizeof(networkAddress));
             payload.append(reinterpret_cast <const char*> (message), sizeof(zbossNodeDescriptorResponseStruct));
 
@@ -283,20 +313,20 @@ void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
 
         case ZBOSS_ZDO_SIMPLE_DESC_REQ:
         {
-            const zbossSimpleDescriptorResponseStruct *message = reinterpret_cast <const zbossSimpleDescriptorResponseStruct*> (m_replyData.constData());
+            const zbossSimpleDescriptorResponseStruct *message = reinterpret_cast <const zbossSimpleDescriptorResponseStruct*> (reply.constData());
             quint16 networkAddress;
             QByteArray payload;
 
             memcpy(&networkAddress, data.mid(data.length() - sizeof(networkAddress)), sizeof(networkAddress));
 
-            payload.append(1, static_cast <char> (m_replyStatus));
+            payload.append(1, static_cast <char> (status));
             payload.append(reinterpret_cast <const char*> (&networkAddress), sizeof(networkAddress));
             payload.append(1, static_cast <char> (message->inClusterCount * 2 + message->outClusterCount * 2) + sizeof(zbossSimpleDescriptorResponseStruct));
             payload.append(reinterpret_cast <const char*> (message), sizeof(zbossSimpleDescriptorResponseStruct) - 2);
             payload.append(1, static_cast <char> (message->inClusterCount));
-            payload.append(m_replyData.mid(sizeof(zbossSimpleDescriptorResponseStruct), message->inClusterCount * 2));
+            payload.append(reply.mid(sizeof(zbossSimpleDescriptorResponseStruct), message->inClusterCount * 2));
             payload.append(1, static_cast <char> (message->outClusterCount));
-            payload.append(m_replyData.mid(sizeof(zbossSimpleDescriptorResponseStruct) + message->inClusterCount * 2), message->outClusterCount * 2);
+            payload.append(reply.mid(sizeof(zbossSimpleDescriptorResponseStruct) + message->inClusterCount * 2), message->outClusterCount * 2);
 
             emit zdoMessageReveived(networkAddress, ZDO_SIMPLE_DESCRIPTOR_REQUEST, payload);
             break;
@@ -309,7 +339,7 @@ void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
 
             memcpy(&networkAddress, data.mid(data.length() - sizeof(networkAddress)), sizeof(networkAddress));
 
-            payload.append(1, static_cast <char> (m_replyStatus));
+            payload.append(1, static_cast <char> (status));
             payload.append(reinterpret_cast <char*> (&networkAddress), sizeof(networkAddress));
             payload.append(data.mid(3, data.length() - 5));
 
@@ -353,7 +383,7 @@ void ZBoss::parsePacket(quint8 type, quint16 command, const QByteArray &data)
         }
     }
 
-    emit requestFinished(static_cast <quint8> (data.at(0)), m_replyStatus);
+    emit requestFinished(static_cast <quint8> (data.at(0)), status);
 }
 
 bool ZBoss::startCoordinator(void)
@@ -562,50 +592,82 @@ bool ZBoss::startCoordinator(void)
 
 void ZBoss::softReset(void)
 {
+    clearFrames();
     sendRequest(ZBOSS_NCP_RESET, QByteArray(1, m_clear ? 0x02 : 0x00));
 }
 
 void ZBoss::parseData(QByteArray &buffer)
 {
-    while (!buffer.isEmpty())
+    while (buffer.length() >= static_cast <int> (sizeof(zbossLowLevelHeaderStruct)))
     {
         zbossLowLevelHeaderStruct *lowLevelHeader = reinterpret_cast <zbossLowLevelHeaderStruct*> (buffer.data());
         quint16 length = qFromLittleEndian(lowLevelHeader->length) + 2;
+        quint8 flags;
 
         if (lowLevelHeader->signature != qToBigEndian <quint16> (ZBOSS_SIGNATURE))
-            return;
+        {
+            int index = buffer.indexOf(QByteArray::fromHex("dead"), 1);
+            buffer.remove(0, index < 0 ? buffer.length() - 1 : index);
+            continue;
+        }
 
         if (lowLevelHeader->crc != getCRC8(reinterpret_cast <quint8*> (lowLevelHeader) + 2, sizeof(zbossLowLevelHeaderStruct) - 3))
         {
-            logWarning << QString("Frame %1 low level header CRC mismatch").arg(QString(buffer.mid(0, length).toHex(':')));
-            return;
+            logWarning << QString("Frame %1 low level header CRC mismatch").arg(QString(buffer.mid(0, sizeof(zbossLowLevelHeaderStruct)).toHex(':')));
+            buffer.remove(0, 1);
+            continue;
         }
 
+        if (buffer.length() < length)
+            return;
+
         logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length).toHex(':');
 
-        if (lowLevelHeader->flags & ZBOSS_FLAG_ACK)
+        flags = lowLevelHeader->flags;
+
+        if (flags & ZBOSS_FLAG_ACK)
         {
-            if (m_sequenceId == (lowLevelHeader->flags >> 4 & 0x03))
-            {
-                m_sequenceId = (m_sequenceId + 1) & 0x03;
-                emit acknowledgeReceived();
-            }
+            acknowledgeFrame(flags >> 4 & 0x03);
+            buffer.remove(0, length);
+            continue;
         }
-        else
+
+        if (flags & ZBOSS_FLAG_RETRANSMIT && (flags >> 2 & 0x03) == m_acknowledgeId)
         {
-            m_acknowledgeId = lowLevelHeader->flags >> 2 & 0x03;
             sendAcknowledge();
+            buffer.remove(0, length);
+            continue;
         }
 
+        m_acknowledgeId = flags >> 2 & 0x03;
+        sendAcknowledge();
+
         if (length > 9)
         {
             if (*(reinterpret_cast <quint16*> (buffer.data() + 7)) != getCRC16(reinterpret_cast <quint8*> (buffer.data() + 9), length - 9))
             {
                 logWarning << QString("Packet %1 CRC mismatch").arg(QString(buffer.mid(0, length).toHex(':')));
-                return;
+                buffer.remove(0, length);
+                continue;
+            }
+
+            if (flags & ZBOSS_FLAG_FIRST_FRAGMENT)
+                m_fragment.clear();
+
+            if (flags & ZBOSS_FLAG_FIRST_FRAGMENT || !m_fragment.isEmpty())
+                m_fragment.append(buffer.constData() + 9, length - 9);
+
+            if (m_fragment.length() > ZBOSS_MAX_PACKET_LENGTH)
+            {
+                logWarning << "Fragmented packet exceeds" << ZBOSS_MAX_PACKET_LENGTH << "bytes, packet dropped";
+                m_fragment.clear();
             }
 
-            m_queue.enqueue(buffer.mid(9, length - 9));
+            if (flags & ZBISS_FLAG_LAST_FRAGMENT && !m_fragment.isEmpty())
+            {
+                m_queue.enqueue(m_fragment);
+                m_fragment.clear();
+            }
         }
 
         buffer.remove(0, length);
@@ -644,9 +706,38 @@ void ZBoss::serialError(QSerialPort::SerialPortError error)
         return;
     }
 
-    m_serial->close();
-    QThread::msleep(ZBOSS_RESET_DELAY);
-    m_serial->open(QIODevice::ReadWrite);
+    QMetaObject::invokeMethod(m_transport, "reopen", Qt::QueuedConnection, Q_ARG(int, ZBOSS_RESET_DELAY));
+}
+
+void ZBoss::retransmitFrame(void)
+{
+    quint8 id;
+
+    if (m_frames.isEmpty())
+        return;
+
+    if (++m_retransmitCount <= ZBOSS_RETRANSMIT_COUNT)
+    {
+        sendFrame(true);
+        return;
+    }
+
+    logWarning << "Frame not acknowledged after" << ZBOSS_RETRANSMIT_COUNT << "retransmissions, request dropped";
+    id = m_frames.head().id;
+
+    do
+        m_frames.dequeue();
+    while (!m_frames.isEmpty() && !(m_frames.head().flags & ZBOSS_FLAG_FIRST_FRAGMENT));
+
+    m_sequenceId = (m_sequenceId + 1) & 0x03;
+    m_retransmitCount = 0;
+
+    emit requestFinished(id, ZBOSS_STATUS_NOT_ACKNOWLEDGED);
+
+    if (m_frames.isEmpty())
+        return;
+
+    sendFrame();
 }
 
 void ZBoss::handleQueue(void)
@@ -3,6 +3,10 @@
 
 #define ZBOSS_REQUEST_TIMEOUT                           2000
 #define ZBOSS_RESET_DELAY                               2000
+#define ZBOSS_ACKNOWLEDGE_TIMEOUT                       500
+#define ZBOSS_RETRANSMIT_COUNT                          3
+#define ZBOSS_MAX_FRAGMENT_LENGTH                       200
+#define ZBOSS_MAX_PACKET_LENGTH                         2048
 
 #define ZBOSS_SIGNATURE                                 0xDEAD
 #define ZBOSS_PROTOCOL_VERSION                          0x00
@@ -15,9 +19,12 @@
 #define ZBOSS_TYPE_RESPONSE                             0x01
 
 #define ZBOSS_FLAG_ACK                                  0x01
+#define ZBOSS_FLAG_RETRANSMIT                           0x02
 #define ZBOSS_FLAG_FIRST_FRAGMENT                       0x40
 #define ZBISS_FLAG_LAST_FRAGMENT                        0x80
 
+#define ZBOSS_STATUS_NOT_ACKNOWLEDGED                   0xFE
+
 #define ZBOSS_GET_MODULE_VERSION                        0x0001
 #define ZBOSS_NCP_RESET                                 0x0002
 #define ZBOSS_GET_ZIGBEE_ROLE                           0x0004
@@ -206,6 +213,13 @@ struct zbossSetPolicyStruct
 
 #pragma pack(pop)
 
+struct ZBossFrame
+{
+    quint8 id;
+    quint8 flags;
+    QByteArray data;
+};
+
 class ZBoss : public Adapter
 {
     Q_OBJECT
@@ -235,16 +249,23 @@ private:
     quint16 m_command;
     QByteArray m_replyData;
 
-    quint8 m_sequenceId, m_acknowledgeId;
+    QTimer *m_acknowledgeTimer;
+    quint8 m_sequenceId, m_acknowledgeId, m_retransmitCount;
     quint16 m_lqiRequestAddress;
 
+    QQueue <ZBossFrame> m_frames;
+    QByteArray m_fragment;
+
     QList <zbossSetPolicyStruct> m_policy;
 
     quint8 getCRC8(quint8 *data, quint32 length);
     quint16 getCRC16(quint8 *data, quint32 length);
 
     bool sendRequest(quint16 command, const QByteArray &data = QByteArray(), quint8 id = 0);
+    void sendFrame(bool retransmit = false);
     void sendAcknowledge(void);
+    void acknowledgeFrame(quint8 sequenceId);
+    void clearFrames(void);
     void parsePacket(quint8 type, quint16 command, const QByteArray &data);
 
     bool startCoordinator(void);
@@ -255,12 +276,12 @@ private:
 
 private slots:
 
+    void retransmitFrame(void);
     void handleQueue(void) override;
     void serialError(QSerialPort::SerialPortError error) override;
 
 signals:
 
-    void acknowledgeReceived(void);
     void dataReceived(void);
 
 };
@@ -37,6 +37,16 @@ QByteArray writeAttributeRequest(quint8 transactionId, quint16 manufacturerCode,
     return zclHeader(FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_WRITE_ATTRIBUTES, manufacturerCode).append(reinterpret_cast <char*> (&payload), sizeof(payload)).append(data);
 }
 
+QByteArray defaultResponse(quint8 transactionId, quint16 manufacturerCode, quint8 commandId, quint8 status)
+{
+    defaultResponseStruct response;
+
+    response.commandId = commandId;
+    response.status = status;
+
+    return zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_DEFAULT_RESPONSE, manufacturerCode).append(reinterpret_cast <char*> (&response), sizeof(response));
+}
+
 quint8 zclDataSize(quint8 dataType)
 {
     switch (dataType)
@@ -345,6 +345,7 @@ struct tuyaTimeStruct
 QByteArray zclHeader(quint8 frameControl, quint8 transactionId, quint8 commandId, quint16 manufacturerCode = 0);
 QByteArray readAttributesRequest(quint8 transactionId, quint16 manufacturerCode, QList <quint16> attributes);
 QByteArray writeAttributeRequest(quint8 transactionId, quint16 manufacturerCode, quint16 attributeId, quint8 dataType, const QByteArray &data);
+QByteArray defaultResponse(quint8 transactionId, quint16 manufacturerCode, quint8 commandId, quint8 status);
 
 quint8 zclDataSize(quint8 dataType);
 quint8 zclDataSize(quint8 dataType, const QByteArray &data, quint8 *offset);
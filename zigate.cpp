@@ -1,4 +1,5 @@
 #include <QtEndian>
+#include "checksum.h"
 #include "logger.h"
 #include "zigate.h"
 
@@ -83,13 +84,7 @@ bool ZiGate::lqiRequest(quint8 id, quint16 networkAddress, quint8 index)
 
 quint8 ZiGate::getChecksum(const zigateHeaderStruct *header, const QByteArray &payload)
 {
-    QByteArray data = QByteArray(reinterpret_cast <const char*> (header), 4).append(payload);
-    quint8 checksum = 0;
-
-    for (int i = 0; i < data.length(); i++)
-        checksum ^= data.at(i);
-
-    return checksum;
+    return xorChecksum(reinterpret_cast <const quint8*> (payload.constData()), payload.length(), xorChecksum(reinterpret_cast <const quint8*> (header), 4));
 }
 
 QByteArray ZiGate::encodeFrame(const QByteArray &data)
@@ -369,12 +364,27 @@ void ZiGate::parseData(QByteArray &buffer)
 {
     while (!buffer.isEmpty())
     {
-        int length = buffer.indexOf(0x03);
+        int length;
         QByteArray frame, packet;
 
-        if (!buffer.startsWith(0x01) || length < 6)
+        if (!buffer.startsWith(0x01))
+        {
+            int index = buffer.indexOf(0x01);
+            buffer.remove(0, index < 0 ? buffer.length() : index);
+            continue;
+        }
+
+        length = buffer.indexOf(0x03);
+
+        if (length < 0)
             return;
 
+        if (length < 6)
+        {
+            buffer.remove(0, length + 1);
+            continue;
+        }
+
         logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 1).toHex(':');
         frame = buffer.mid(1, length - 1);
 
@@ -10,7 +10,7 @@
 #include "zigbee.h"
 #include "zstack.h"
 
-ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(config), m_requestTimer(new QTimer(this)), m_neignborsTimer(new QTimer(this)), m_pingTimer(new QTimer(this)), m_statusLedTimer(new QTimer(this)), m_adapter(nullptr), m_devices(new DeviceList(m_config, this)), m_events(QMetaEnum::fromType <Event> ()), m_requestId(0), m_interPanLock(false)
+ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(config), m_requestTimer(new QTimer(this)), m_neignborsTimer(new QTimer(this)), m_pingTimer(new QTimer(this)), m_statusLedTimer(new QTimer(this)), m_adapter(nullptr), m_devices(new DeviceList(m_config, this)), m_events(QMetaEnum::fromType <Event> ()), m_requestId(0), m_transactionId(0), m_tagId(0), m_requestWindow(1), m_requestCredit(0), m_interPanLock(false)
 {
     m_statusLedPin = m_config->value("gpio/status", "-1").toString();
     m_blinkLedPin = m_config->value("gpio/blink", "-1").toString();
@@ -18,8 +18,13 @@ ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(c
     m_discovery = m_config->value("default/discovery", true).toBool();
     m_cloud = m_config->value("default/cloud", true).toBool();
     m_debug = m_config->value("debug/zigbee", false).toBool();
+    m_rediscovery = m_config->value("zigbee/rediscovery", false).toBool();
 
-    connect(m_devices, &DeviceList::statusUpdated, this, &ZigBee::statusUpdated);
+    m_deadlines.insert(RequestPriority::Interactive, m_config->value("deadline/interactive", 10).toLongLong());
+    m_deadlines.insert(RequestPriority::Alarm, m_config->value("deadline/alarm", 0).toLongLong());
+    m_deadlines.insert(RequestPriority::Maintenance, m_config->value("deadline/maintenance", 0).toLongLong());
+
+    connect(m_devices, &DeviceList::statusUpdated, this, &ZigBee::updateStatus);
     connect(m_devices, &DeviceList::endpointUpdated, this, &ZigBee::endpointUpdated);
     connect(m_devices, &DeviceList::pollRequest, this, &ZigBee::pollRequest);
     connect(m_statusLedTimer, &QTimer::timeout, this, &ZigBee::updateStatusLed);
@@ -104,9 +109,9 @@ void ZigBee::updateDevice(const QString &deviceName, const QString &name, const
         emit deviceEvent(device.data(), Event::deviceAboutToRename);
 
         if (!other.isNull() && other->removed())
-            m_devices->remove(other->ieeeAddress());
+            m_devices->eraseDevice(other);
 
-        device->setName(name.isEmpty() ? device->ieeeAddress().toHex(':') : name.trimmed());
+        m_devices->setName(device, name.isEmpty() ? device->ieeeAddress().toHex(':') : name.trimmed());
         check = true;
     }
 
@@ -146,7 +151,7 @@ void ZigBee::removeDevice(const QString &deviceName, bool force)
 
     if (!force)
     {
-        enqueueRequest(device, RequestType::Leave);
+        enqueueRequest(device, RequestType::Leave, RequestPriority::Interactive);
         return;
     }
 
@@ -173,13 +178,9 @@ void ZigBee::setupDevice(const QString &deviceName, bool reportings)
         return;
     }
 
-    if (!configureDevice(device))
-    {
-        logWarning << device << "configuration failed";
-        return;
-    }
-
-    logInfo << device << "configuration updated";
+    m_sequence = Sequence(new SequenceObject(device, SequenceType::Configure, RequestPriority::Interactive));
+    configureDevice(device);
+    startSequence();
 }
 
 void ZigBee::setupReporting(const QString &deviceName, quint8 endpointId, const QString &reportingName, quint16 minInterval, quint16 maxInterval, quint16 valueChange)
@@ -302,7 +303,7 @@ void ZigBee::otaControl(const QString &deviceName, bool refresh, bool upgrade)
         payload.jitter = 0x64;
 
         logInfo << device << "OTA upgrade notification enqueued";
-        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT, m_requestId, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)));
+        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT, m_transactionId++, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)), RequestPriority::Alarm);
     }
 }
 
@@ -325,14 +326,15 @@ void ZigBee::getProperties(const QString &deviceName)
 void ZigBee::clusterRequest(const QString &deviceName, quint8 endpointId, quint16 clusterId, quint16 manufacturerCode, quint8 commandId, const QByteArray &payload, bool global)
 {
     const Device &device = m_devices->byName(deviceName);
+    quint8 transactionId = m_transactionId++;
     QByteArray request;
 
     if (device.isNull() || device->removed() || !device->active() || device->logicalType() == LogicalType::Coordinator)
         return;
 
-    request = zclHeader(global ? 0x00 : FC_CLUSTER_SPECIFIC, m_requestId, commandId, manufacturerCode).append(payload);
-    logInfo << "Device" << device->name() << "endpoint" << QString::asprintf("0x%02x", endpointId ? endpointId : 0x01) << "cluster" << QString::asprintf("0x%04x", clusterId) << "request" << m_requestId << "enqueued with data" << request.toHex(':');
-    enqueueRequest(device, endpointId ? endpointId : 0x01, clusterId, request, QString("request %1").arg(m_requestId), true);
+    request = zclHeader(global ? 0x00 : FC_CLUSTER_SPECIFIC, transactionId, commandId, manufacturerCode).append(payload);
+    logInfo << "Device" << device->name() << "endpoint" << QString::asprintf("0x%02x", endpointId ? endpointId : 0x01) << "cluster" << QString::asprintf("0x%04x", clusterId) << "request" << transactionId << "enqueued with data" << request.toHex(':');
+    m_transactions.insert(transactionId, enqueueRequest(device, endpointId ? endpointId : 0x01, clusterId, request, RequestPriority::Interactive, QString("request %1").arg(transactionId), true));
 }
 
 void ZigBee::touchLinkRequest(const QByteArray &ieeeAddress, quint8 channel, bool reset)
@@ -349,7 +351,7 @@ void ZigBee::touchLinkRequest(const QByteArray &ieeeAddress, quint8 channel, boo
 
     m_adapter->resetInterPanChannel();
 
-    if (!m_requests.isEmpty())
+    if (!m_queues.isEmpty())
         m_requestTimer->start();
 
     m_interPanLock = false;
@@ -367,64 +369,586 @@ void ZigBee::deviceAction(const QString &deviceName, quint8 endpointId, const QS
         if (endpointId && it.key() != endpointId)
             continue;
 
-        for (int i = 0; i < it.value()->actions().count(); i++)
+        auto item = it.value()->namedActions().constFind(name);
+
+        if (item == it.value()->namedActions().constEnd())
+            item = it.value()->namedActions().constFind(QString());
+
+        if (item == it.value()->namedActions().constEnd())
+            continue;
+
+        for (int i = 0; i < item->count(); i++)
         {
-            const Action &action = it.value()->actions().at(i);
+            const Action &action = item->at(i);
+            QByteArray request = action->request(name, data);
+
+            if (request.isEmpty())
+                continue;
 
-            if (action->name() == name || action->name() == "tuyaDataPoints" || action->actions().contains(name))
+            if (data.type() != QVariant::String || !data.toString().isEmpty())
             {
-                QByteArray request = action->request(name, data);
+                Request pending = data.type() != QVariant::String ? pendingAction(device, it.key(), action, QString("%1 action request").arg(name)) : Request();
 
-                if (request.isEmpty())
-                    continue;
+                if (!pending.isNull())
+                {
+                    logDebug(m_debug) << device << name.toUtf8().constData() << "action request superseded";
+                    qvariant_cast <DataRequest> (pending->data())->setData(request);
+                    pending->setDeadline(requestDeadline(device, pending->priority()));
+                }
+                else
+                {
+                    Request queued = enqueueRequest(device, it.key(), action->clusterId(), request, RequestPriority::Interactive, QString("%1 action request").arg(name), false, action->manufacturerCode(), action);
+                    qvariant_cast <DataRequest> (queued->data())->setAbsolute(data.type() != QVariant::String);
+                }
+            }
+
+            break;
+        }
+    }
+}
 
-                if (data.type() != QVariant::String || !data.toString().isEmpty())
-                    enqueueRequest(device, it.key(), action->clusterId(), request, QString("%1 action request").arg(name), false, action->manufacturerCode(), action);
+void ZigBee::groupAction(quint16 groupId, const QString &name, const QVariant &data)
+{
+    Action action = m_groupActions.value(name);
+    QByteArray request;
 
+    if (action.isNull())
+    {
+        int type = QMetaType::type(QString(name).append("Action").toUtf8());
+
+        if (!type)
+            return;
+
+        action = Action(reinterpret_cast <ActionObject*> (QMetaType::create(type)));
+        m_groupActions.insert(name, action);
+    }
+
+    request = action->request(name, data);
+
+    if (request.isEmpty() || (data.type() == QVariant::String && data.toString().isEmpty()))
+        return;
+
+    if (!m_adapter->multicastRequest(adapterTag(), groupId, 0x01, 0xFF, action->clusterId(), request))
+    {
+        logWarning << "Group" << groupId << action->name().toUtf8().constData() << "action request aborted";
+        return;
+    }
+
+    logInfo << "Group" << groupId << action->name().toUtf8().constData() << "action request sent";
+}
+
+Request ZigBee::enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, RequestPriority priority, const QString &name, bool debug, quint16 manufacturerCode, const Action &action)
+{
+    DataRequest request(new DataRequestObject(device, endpointId, clusterId, data, name, debug, manufacturerCode, action));
+
+    if (m_sequence.isNull() && !debug && action.isNull())
+    {
+        Request item = mergeRequest(device, request, priority);
+
+        if (!item.isNull())
+            return item;
+    }
+
+    return enqueueRequest(device, QVariant::fromValue(request), RequestType::Data, priority);
+}
+
+Request ZigBee::enqueueRequest(const Device &device, RequestType type, RequestPriority priority)
+{
+    return enqueueRequest(device, QVariant::fromValue(device), type, priority);
+}
+
+Request ZigBee::enqueueRequest(const Device &device, const QVariant &data, RequestType type, RequestPriority priority)
+{
+    Request request(new RequestObject(device, data, type, m_sequence.isNull() ? priority : m_sequence->priority()));
+    QQueue <Device> &queue = m_queues[request->priority()];
+
+    if (!m_requestTimer->isActive() && !m_interPanLock)
+        m_requestTimer->start();
+
+    if (!m_sequence.isNull())
+    {
+        request->setSequence(m_sequence);
+        m_sequence->requests().enqueue(request);
+    }
+    else
+        request->setDeadline(requestDeadline(device, request->priority()));
+
+    while (m_requests.contains(m_requestId))
+        m_requestId++;
+
+    request->setId(m_requestId++);
+    m_requests.insert(request->id(), request);
+
+    if (!queue.contains(device))
+        queue.enqueue(device);
+
+    device->requests().enqueue(request->id());
+    return request;
+}
+
+void ZigBee::enqueueReply(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data)
+{
+    m_replies.enqueue({device, endpointId, clusterId, data});
+
+    if (!m_requestTimer->isActive() && !m_interPanLock)
+        m_requestTimer->start();
+}
+
+Request ZigBee::mergeRequest(const Device &device, const DataRequest &request, RequestPriority priority)
+{
+    QByteArray data = request->data();
+    int offset = data.length() && data.at(0) & FC_MANUFACTURER_SPECIFIC ? 5 : 3;
+
+    if (data.length() <= offset || data.at(0) & FC_CLUSTER_SPECIFIC || data.at(offset - 1) != CMD_READ_ATTRIBUTES)
+        return Request();
+
+    for (int i = 0; i < device->requests().count(); i++)
+    {
+        Request item = m_requests.value(device->requests().at(i));
+        QList <QByteArray> attributes;
+
+        if (item.isNull() || item->status() != RequestStatus::Pending || item->type() != RequestType::Data || item->priority() != priority || !item->sequence().isNull())
+            continue;
+
+        const DataRequest &pending = qvariant_cast <DataRequest> (item->data());
+        QByteArray buffer = pending->data();
+
+        if (pending->endpointId() != request->endpointId() || pending->clusterId() != request->clusterId() || pending->debug() || !pending->action().isNull() || buffer.length() <= offset || buffer.at(0) != data.at(0) || buffer.mid(1, offset - 3) != data.mid(1, offset - 3) || buffer.at(offset - 1) != CMD_READ_ATTRIBUTES)
+            continue;
+
+        for (int j = offset; j + 1 < data.length(); j += 2)
+        {
+            QByteArray attributeId = data.mid(j, 2);
+            bool check = false;
+
+            for (int k = offset; k + 1 < buffer.length(); k += 2)
+            {
+                if (buffer.mid(k, 2) != attributeId)
+                    continue;
+
+                check = true;
                 break;
             }
+
+            if (!check && !attributes.contains(attributeId))
+                attributes.append(attributeId);
         }
+
+        if ((buffer.length() - offset) / 2 + attributes.count() > MAX_READ_ATTRIBUTES)
+            continue;
+
+        for (int j = 0; j < attributes.count(); j++)
+            buffer.append(attributes.at(j));
+
+        logDebug(m_debug) << device << "cluster" << QString::asprintf("0x%04x", request->clusterId()) << "read attributes request merged with pending request" << item->id();
+        pending->setData(buffer);
+        return item;
     }
+
+    return Request();
 }
 
-void ZigBee::groupAction(quint16 groupId, const QString &name, const QVariant &data)
+Request ZigBee::pendingAction(const Device &device, quint8 endpointId, const Action &action, const QString &name)
 {
-    int type = QMetaType::type(QString(name).append("Action").toUtf8());
+    qint64 time = QDateTime::currentMSecsSinceEpoch();
 
-    if (type)
+    for (int i = 0; i < device->requests().count(); i++)
     {
-        Action action(reinterpret_cast <ActionObject*> (QMetaType::create(type)));
-        QByteArray request = action->request(name, data);
+        Request item = m_requests.value(device->requests().at(i));
 
-        if (request.isEmpty() || (data.type() == QVariant::String && data.toString().isEmpty()))
-            return;
+        if (item.isNull() || item->status() != RequestStatus::Pending || item->type() != RequestType::Data || (item->deadline() && item->deadline() < time))
+            continue;
+
+        const DataRequest &request = qvariant_cast <DataRequest> (item->data());
+
+        if (request->endpointId() != endpointId || request->action() != action || request->name() != name || !request->absolute())
+            continue;
+
+        return item;
+    }
+
+    return Request();
+}
+
+qint64 ZigBee::requestDeadline(const Device &device, RequestPriority priority)
+{
+    qint64 value = device->options().contains("requestDeadline") ? device->options().value("requestDeadline").toLongLong() : m_deadlines.value(priority);
+    return value > 0 ? QDateTime::currentMSecsSinceEpoch() + value * 1000 : 0;
+}
+
+void ZigBee::removeRequest(const Request &request)
+{
+    auto it = m_tags.find(request->tag());
+
+    if (it != m_tags.end() && it.value() == request->id())
+        m_tags.erase(it);
 
-        if (!m_adapter->multicastRequest(m_requestId, groupId, 0x01, 0xFF, action->clusterId(), request))
+    if (m_requests.value(request->id()) == request)
+        m_requests.remove(request->id());
+
+    if ((!m_queues.isEmpty() || !m_replies.isEmpty()) && !m_requestTimer->isActive() && !m_interPanLock)
+        m_requestTimer->start();
+}
+
+void ZigBee::removeReply(quint8 tag)
+{
+    m_replyTags.remove(tag);
+
+    if ((!m_queues.isEmpty() || !m_replies.isEmpty()) && !m_requestTimer->isActive() && !m_interPanLock)
+        m_requestTimer->start();
+}
+
+quint8 ZigBee::adapterTag(void)
+{
+    while (m_tags.contains(m_tagId) || m_replyTags.contains(m_tagId))
+        m_tagId++;
+
+    return m_tagId++;
+}
+
+void ZigBee::sendRequest(const Device &device, const Request &request)
+{
+    quint8 tag = adapterTag(), retries;
+
+    m_tags.insert(tag, request->id());
+    request->setTag(tag);
+
+    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered(), request->routeDiscovery());
+
+    switch (request->type())
+    {
+        case RequestType::Data:
         {
-            logWarning << "Group" << groupId << action->name().toUtf8().constData() << "action request aborted";
-            return;
+            const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+
+            if (!m_adapter->unicastRequest(tag, device->networkAddress(), 0x01, data->endpointId(), data->clusterId(), data->data()))
+            {
+                logWarning << device << (!data->name().isEmpty() ? data->name().toUtf8().constData() : "data request") << "aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
+                request->setStatus(RequestStatus::Aborted);
+            }
+
+            break;
+        }
+
+        case RequestType::Binding:
+        {
+            const BindingRequest &binding = qvariant_cast <BindingRequest> (request->data());
+            const Endpoint &endpoint = binding->endpoint();
+
+            if (!m_adapter->bindRequest(tag, device->networkAddress(), endpoint->id(), binding->clusterId(), binding->address(), binding->dstEndpointId(), binding->unbind()))
+            {
+                logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", binding->clusterId()) << binding->name().toUtf8().constData() << "request aborted";
+                request->setStatus(RequestStatus::Aborted);
+            }
+
+            break;
+        }
+
+        case RequestType::Group:
+        {
+            const GroupRequest &group = qvariant_cast <GroupRequest> (request->data());
+            const Endpoint &endpoint = group->endpoint();
+
+            if (!m_adapter->unicastRequest(tag, device->networkAddress(), 0x01, endpoint->id(), CLUSTER_GROUPS, group->data()))
+            {
+                logWarning << device << endpoint << group->name().toUtf8().constData() << "aborted";
+                request->setStatus(RequestStatus::Aborted);
+            }
+
+            break;
+        }
+
+        case RequestType::Reporting:
+        {
+            const ReportingRequest &reporting = qvariant_cast <ReportingRequest> (request->data());
+            const Endpoint &endpoint = reporting->endpoint();
+
+            if (!m_adapter->unicastRequest(tag, device->networkAddress(), 0x01, endpoint->id(), reporting->reporting()->clusterId(), reporting->data()))
+            {
+                logWarning << device << endpoint << reporting->reporting()->name().toUtf8().constData() << "reporting configuration request aborted";
+                request->setStatus(RequestStatus::Aborted);
+            }
+
+            break;
+        }
+
+        case RequestType::Leave:
+        {
+            if (!m_adapter->leaveRequest(tag, device->networkAddress()))
+            {
+                logWarning << device << "leave request aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
+                request->setStatus(RequestStatus::Aborted);
+            }
+
+            break;
+        }
+
+        case RequestType::LQI:
+        {
+            if (!m_adapter->lqiRequest(tag, device->networkAddress(), device->lqiRequestIndex()))
+                request->setStatus(RequestStatus::Aborted);
+
+            break;
+        }
+
+        case RequestType::Interview:
+        {
+            if (!interviewRequest(tag, device))
+                request->setStatus(RequestStatus::Aborted);
+
+            break;
         }
+    }
+
+    if (request->status() == RequestStatus::Aborted)
+    {
+        updateWindow(true);
+
+        if (retryRequest(request, false))
+            return;
+
+        updateSequence(request, false);
+        removeRequest(request);
+    }
+
+    if (request->status() == RequestStatus::Finished || request->status() == RequestStatus::Aborted)
+        return;
+
+    retries = request->retries();
+
+    request->setStatus(RequestStatus::Sent);
+    request->setTime(QDateTime::currentMSecsSinceEpoch());
+
+    QTimer::singleShot(NETWORK_REQUEST_TIMEOUT, this, [this, request, retries] () { if (request->retries() == retries) requestTimeout(request); });
+}
 
-        logInfo << "Group" << groupId << action->name().toUtf8().constData() << "action request sent";
+void ZigBee::updateWindow(bool congestion)
+{
+    if (congestion)
+    {
+        m_requestWindow = m_requestWindow > 1 ? m_requestWindow / 2 : 1;
+        m_requestCredit = 0;
+        return;
     }
+
+    if (m_requestWindow >= m_adapter->requestLimit() || ++m_requestCredit < m_requestWindow)
+        return;
+
+    m_requestWindow++;
+    m_requestCredit = 0;
 }
 
-void ZigBee::enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, const QString &name, bool debug, quint16 manufacturerCode, const Action &action)
+bool ZigBee::retryRequest(const Request &request, bool route)
 {
-    DataRequest request(new DataRequestObject(device, endpointId, clusterId, data, name, debug, manufacturerCode, action));
+    auto it = m_tags.find(request->tag());
+    int delay;
+
+    if (request->type() == RequestType::Interview || request->retries() >= MAX_REQUEST_RETRIES)
+        return false;
+
+    if (it != m_tags.end() && it.value() == request->id())
+        m_tags.erase(it);
+
+    delay = REQUEST_RETRY_DELAY << request->retries();
+    delay = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+
+    request->setStatus(RequestStatus::Pending);
+    request->setRetries(request->retries() + 1);
+    request->setRouteDiscovery(route && m_rediscovery);
+
+    logDebug(m_debug) << request->device() << "request" << request->id() << "retry" << request->retries() << "scheduled in" << delay << "ms";
+
+    QTimer::singleShot(delay, this, [this, request] () { requeueRequest(request); });
+    return true;
+}
+
+void ZigBee::requeueRequest(const Request &request)
+{
+    const Device &device = request->device();
+
+    if (request->status() != RequestStatus::Pending || m_requests.value(request->id()) != request)
+        return;
+
+    QQueue <Device> &queue = m_queues[request->priority()];
+    device->requests().prepend(request->id());
+
+    if (!queue.contains(device))
+        queue.enqueue(device);
 
     if (!m_requestTimer->isActive() && !m_interPanLock)
         m_requestTimer->start();
+}
+
+void ZigBee::requestTimeout(const Request &request)
+{
+    auto it = m_tags.find(request->tag());
+
+    if (request->status() != RequestStatus::Sent)
+        return;
+
+    switch (request->type())
+    {
+        case RequestType::Data:
+        {
+            const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+
+            if (!data->name().isEmpty())
+                logWarning << data->device() << data->name().toUtf8().constData() << "timed out";
+
+            break;
+        }
 
-    m_requests.insert(m_requestId++, Request(new RequestObject(QVariant::fromValue(request), RequestType::Data)));
+        case RequestType::Binding:
+        {
+            const BindingRequest &binding = qvariant_cast <BindingRequest> (request->data());
+            logWarning << binding->endpoint()->device() << binding->endpoint() << "cluster" << QString::asprintf("0x%04x", binding->clusterId()) << binding->name().toUtf8().constData() << "timed out";
+            break;
+        }
+
+        case RequestType::Group:
+        {
+            const GroupRequest &group = qvariant_cast <GroupRequest> (request->data());
+            logWarning << group->endpoint()->device() << group->endpoint() << group->name().toUtf8().constData() << "timed out";
+            break;
+        }
+
+        case RequestType::Reporting:
+        {
+            const ReportingRequest &reporting = qvariant_cast <ReportingRequest> (request->data());
+            logWarning << reporting->endpoint()->device() << reporting->endpoint() << reporting->reporting()->name().toUtf8().constData() << "reporting configuration request timed out";
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (it != m_tags.end() && it.value() == request->id())
+        updateWindow(true);
+
+    request->setStatus(RequestStatus::Aborted);
+    updateSequence(request, false);
+    removeRequest(request);
+}
+
+void ZigBee::expireRequest(const Request &request)
+{
+    const Device &device = request->device();
+    QString name;
+
+    if (request->type() == RequestType::Data)
+        name = qvariant_cast <DataRequest> (request->data())->name();
+
+    logWarning << device << (!name.isEmpty() ? name.toUtf8().constData() : "request") << "expired";
+
+    request->setStatus(RequestStatus::Expired);
+    emit deviceEvent(device.data(), Event::requestFinished, {{"status", "expired"}});
+
+    updateSequence(request, false);
+    removeRequest(request);
 }
 
-void ZigBee::enqueueRequest(const Device &device, RequestType type)
+void ZigBee::updateSequence(const Request &request, bool success)
 {
+    Sequence sequence = request->sequence();
+
+    if (sequence.isNull() || sequence->requests().isEmpty() || sequence->requests().head() != request)
+        return;
+
+    sequence->requests().dequeue();
+
+    if (!success)
+    {
+        while (!sequence->requests().isEmpty())
+        {
+            const Request &item = sequence->requests().dequeue();
+            item->setStatus(RequestStatus::Aborted);
+            removeRequest(item);
+        }
+
+        sequenceFinished(sequence, false);
+        return;
+    }
+
+    if (sequence->requests().isEmpty())
+    {
+        sequenceFinished(sequence, true);
+        return;
+    }
+
     if (!m_requestTimer->isActive() && !m_interPanLock)
         m_requestTimer->start();
+}
+
+void ZigBee::startSequence(void)
+{
+    Sequence sequence = m_sequence;
+
+    m_sequence.clear();
+
+    if (!sequence->requests().isEmpty())
+        return;
+
+    sequenceFinished(sequence, true);
+}
+
+void ZigBee::sequenceFinished(const Sequence &sequence, bool success)
+{
+    const Device &device = sequence->device();
+
+    switch (sequence->type())
+    {
+        case SequenceType::Interview:
+        {
+            if (!success)
+            {
+                logWarning << device << "interview finished with errors";
+                emit deviceEvent(device.data(), Event::interviewError);
+            }
+            else
+            {
+                device->setInterviewStatus(InterviewStatus::Finished);
+                logInfo << device << "interview finished successfully";
+                emit deviceEvent(device.data(), Event::interviewFinished);
+            }
+
+            m_devices->storeDatabase();
+            break;
+        }
+
+        case SequenceType::Configure:
+        {
+            if (!success)
+            {
+                logWarning << device << "configuration failed";
+                return;
+            }
+
+            logInfo << device << "configuration updated";
+            break;
+        }
 
-    m_requests.insert(m_requestId++, Request(new RequestObject(QVariant::fromValue(device), type)));
+        case SequenceType::Groups:
+        {
+            if (!success)
+                logWarning << device << "groups restore failed";
+
+            return;
+        }
+    }
+
+    if (!success || device->batteryPowered())
+        return;
+
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    {
+        if (it.value()->groups().isEmpty())
+            continue;
+
+        logInfo << device << "groups will be restored in 10 seconds...";
+        QTimer::singleShot(10000, this, [this, device] () { restoreGroups(device); });
+        break;
+    }
 }
 
 bool ZigBee::interviewRequest(quint8 id, const Device &device)
@@ -481,7 +1005,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                 if (!it.value()->inClusters().contains(CLUSTER_BASIC))
                     continue;
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(id, 0x0000, {0x0001, 0x0004, 0x0005, 0x0007, 0x4000})))
+                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(m_transactionId++, 0x0000, {0x0001, 0x0004, 0x0005, 0x0007, 0x4000})))
                 {
                     interviewError(device, "read basic cluster attributes request failed");
                     return false;
@@ -512,7 +1036,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                     default: return false;
                 }
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(id, 0x0000, {attributeId})))
+                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(m_transactionId++, 0x0000, {attributeId})))
                 {
                     interviewError(device, QString::asprintf("read basic cluster attribute 0x%04x request failed", attributeId));
                     return false;
@@ -531,7 +1055,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                 if (device->batteryPowered() || !it.value()->inClusters().contains(CLUSTER_COLOR_CONTROL) || it.value()->colorCapabilities() != 0xFFFF)
                     continue;
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_COLOR_CONTROL, readAttributesRequest(id, 0x0000, {0x400A})))
+                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_COLOR_CONTROL, readAttributesRequest(m_transactionId++, 0x0000, {0x400A})))
                 {
                     interviewError(device, "read color capabilities request failed");
                     return false;
@@ -554,7 +1078,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                 {
                     case ZoneStatus::Unknown:
                     {
-                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(id, 0x0000, {0x0000, 0x0001, 0x0010})))
+                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(m_transactionId++, 0x0000, {0x0000, 0x0001, 0x0010})))
                         {
                             interviewError(device, "read current IAS zone status request failed");
                             return false;
@@ -570,7 +1094,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                         memcpy(&ieeeAddress, m_adapter->ieeeAddress().constData(), sizeof(ieeeAddress));
                         ieeeAddress = qToLittleEndian(qFromBigEndian(ieeeAddress));
 
-                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, writeAttributeRequest(id, 0x0000, 0x0010, DATA_TYPE_IEEE_ADDRESS, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)))))
+                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, writeAttributeRequest(m_transactionId++, 0x0000, 0x0010, DATA_TYPE_IEEE_ADDRESS, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)))))
                         {
                             interviewError(device, "write IAS zone CIE address request failed");
                             return false;
@@ -586,8 +1110,8 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
                         payload.responseCode = 0x00;
                         payload.zoneId = IAS_ZONE_ID;
 
-                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, id, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)));
-                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(id, 0x0000, {0x0000, 0x0010}));
+                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_transactionId++, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)));
+                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(m_transactionId++, 0x0000, {0x0000, 0x0010}));
                         break;
                     }
 
@@ -607,7 +1131,7 @@ bool ZigBee::interviewRequest(quint8 id, const Device &device)
     }
 }
 
-bool ZigBee::interviewQuirks(const Device &device)
+void ZigBee::interviewQuirks(const Device &device)
 {
     Endpoint endpoint = m_devices->endpoint(device, 0x01);
 
@@ -615,8 +1139,8 @@ bool ZigBee::interviewQuirks(const Device &device)
     {
         quint32 value = qToLittleEndian <quint32> (172800);
 
-        if (device->firmware().split('.').first().toInt() >= 24 && !dataRequest(endpoint, CLUSTER_POLL_CONTROL, writeAttributeRequest(m_requestId, 0x0000, 0x0000, DATA_TYPE_32BIT_UNSIGNED, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))), "polling configuration request"))
-            return false;
+        if (device->firmware().split('.').first().toInt() >= 24)
+            enqueueRequest(device, endpoint->id(), CLUSTER_POLL_CONTROL, writeAttributeRequest(m_transactionId++, 0x0000, 0x0000, DATA_TYPE_32BIT_UNSIGNED, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))), RequestPriority::Interactive, "polling configuration request");
     }
 
     if (device->options().value("ikeaRemote").toBool())
@@ -625,18 +1149,20 @@ bool ZigBee::interviewQuirks(const Device &device)
         quint16 groupId = qToLittleEndian <quint16> (IKEA_GROUP);
         bool check = list.value(0).toInt() < 2 || (list.value(0).toInt() == 2 && list.value(1).toInt() < 3) || (list.value(0).toInt() == 2 && list.value(1).toInt() == 3 && list.value(2).toInt() < 75);
 
-        if (check ? !bindRequest(endpoint, CLUSTER_ON_OFF, QByteArray(reinterpret_cast <char*> (&groupId), sizeof(groupId)), 0xFF) : !bindRequest(endpoint, CLUSTER_ON_OFF))
-            return false;
+        if (check)
+            bindRequest(endpoint, CLUSTER_ON_OFF, QByteArray(reinterpret_cast <char*> (&groupId), sizeof(groupId)), 0xFF);
+        else
+            bindRequest(endpoint, CLUSTER_ON_OFF);
     }
 
-    if (device->modelName() == "lumi.switch.n3acn3" && !dataRequest(endpoint, CLUSTER_LUMI, writeAttributeRequest(m_requestId, MANUFACTURER_CODE_LUMI, 0x0200, DATA_TYPE_8BIT_UNSIGNED, QByteArray(1, 0x01)), "magic request"))
-        return false;
+    if (device->modelName() == "lumi.switch.n3acn3")
+        enqueueRequest(device, endpoint->id(), CLUSTER_LUMI, writeAttributeRequest(m_transactionId++, MANUFACTURER_CODE_LUMI, 0x0200, DATA_TYPE_8BIT_UNSIGNED, QByteArray(1, 0x01)), RequestPriority::Interactive, "magic request");
 
-    if (device->options().value("tuyaMagic").toBool() && !dataRequest(endpoint, CLUSTER_BASIC, readAttributesRequest(m_requestId, 0x0000, {0x0004, 0x0000, 0x0001, 0x0005, 0x0007, 0xFFFE}), "magic request"))
-        return false;
+    if (device->options().value("tuyaMagic").toBool())
+        enqueueRequest(device, endpoint->id(), CLUSTER_BASIC, readAttributesRequest(m_transactionId++, 0x0000, {0x0004, 0x0000, 0x0001, 0x0005, 0x0007, 0xFFFE}), RequestPriority::Interactive, "magic request");
 
-    if (device->options().value("tuyaDataQuery").toBool() && !dataRequest(endpoint, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x03), "data query request"))
-        return false;
+    if (device->options().value("tuyaDataQuery").toBool())
+        enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_transactionId++, 0x03), RequestPriority::Interactive, "data query request");
 
     if (device->manufacturerName() == "_TZ3000_xwh1e22x")
     {
@@ -648,11 +1174,8 @@ bool ZigBee::interviewQuirks(const Device &device)
             payload.append(reinterpret_cast <char*> (&value), sizeof(value)).append(1, i + 1);
         }
 
-        if (!dataRequest(endpoint, CLUSTER_GROUPS, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0xF0).append(payload), "groups setup request"))
-            return false;
+        enqueueRequest(device, endpoint->id(), CLUSTER_GROUPS, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_transactionId++, 0xF0).append(payload), RequestPriority::Interactive, "groups setup request");
     }
-
-    return true;
 }
 
 void ZigBee::interviewDevice(const Device &device)
@@ -664,363 +1187,158 @@ void ZigBee::interviewDevice(const Device &device)
     device->timer()->setSingleShot(true);
     device->timer()->start(NETWORK_REQUEST_TIMEOUT);
 
-    enqueueRequest(device, RequestType::Interview);
+    enqueueRequest(device, RequestType::Interview, RequestPriority::Alarm);
 }
 
 void ZigBee::interviewFinished(const Device &device)
 {
-    device->timer()->stop();
-
-    logInfo << device << "manufacturer name is" << device->manufacturerName() << "and model name is" << device->modelName();
-    m_devices->setupDevice(device);
-
-    if (!device->firmware().isEmpty())
-        logInfo << device << "firmware is" << device->firmware();
-
-    if (!device->description().isEmpty())
-        logInfo << device << "identified as" << device->description();
-
-    if (!interviewQuirks(device) || !configureDevice(device))
-    {
-        logWarning << device << "interview finished with errors";
-        emit deviceEvent(device.data(), Event::interviewError);
-    }
-    else
-    {
-        device->setInterviewStatus(InterviewStatus::Finished);
-        logInfo << device << "interview finished successfully";
-        emit deviceEvent(device.data(), Event::interviewFinished);
-    }
-
-    m_devices->storeDatabase();
-}
-
-void ZigBee::interviewError(const Device &device, const QString &reason)
-{
-    if (!device->timer()->isActive())
-        return;
-
-    logWarning << device << "interview error:" << reason;
-    emit deviceEvent(device.data(), Event::interviewError);
-
-    device->timer()->stop();
-}
-
-bool ZigBee::configureDevice(const Device &device)
-{
-    bool groups = false;
-
-    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-    {
-        for (int i = 0; i < it.value()->bindings().count(); i++)
-        {
-            const Binding &binding = it.value()->bindings().at(i);
-
-            if (bindRequest(it.value(), binding->clusterId(), binding->address(), binding->endpointId()))
-                continue;
-
-            return false;
-        }
-    }
-
-    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-    {
-        if (!it.value()->groups().isEmpty())
-            groups = true;
-
-        for (int i = 0; i < it.value()->reportings().count(); i++)
-        {
-            const Reporting &reporting = it.value()->reportings().at(i);
-
-            if (configureReporting(it.value(), reporting))
-                continue;
-
-            return false;
-        }
-    }
-
-    if (groups && !device->batteryPowered())
-    {
-        logInfo << device << "groups will be restored in 10 seconds...";
-        QTimer::singleShot(10000, this, [this, device] () { restoreGroups(device); });
-    }
-
-    return true;
-}
-
-bool ZigBee::configureReporting(const Endpoint &endpoint, const Reporting &reporting)
-{
-    const Device &device = endpoint->device();
-    QMap <QString, QVariant> options = device->options().value(device->options().contains("reporting") ? "reporting" : QString(reporting->name()).append("Reporting")).toMap();
-    QByteArray request = zclHeader(0x00, m_requestId, CMD_CONFIGURE_REPORTING);
-
-    for (int i = 0; i < reporting->attributes().count(); i++)
-    {
-        configureReportingStruct item;
-
-        item.direction = 0x00;
-        item.attributeId = qToLittleEndian(reporting->attributes().at(i));
-        item.dataType = reporting->dataType();
-        item.minInterval = qToLittleEndian <quint16> (options.contains("minInterval") ? options.value("minInterval").toInt() : reporting->minInterval());
-        item.maxInterval = qToLittleEndian <quint16> (options.contains("maxInterval") ? options.value("maxInterval").toInt() : reporting->maxInterval());
-        item.valueChange = qToLittleEndian <quint64> (options.contains("valueChange") ? options.value("valueChange").toInt() : reporting->valueChange());
-
-        request.append(reinterpret_cast <char*> (&item), sizeof(item) - sizeof(item.valueChange) + zclDataSize(item.dataType));
-    }
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
-
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), reporting->clusterId(), request))
-    {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request aborted";
-        return false;
-    }
-
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
-    {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request timed out";
-        return false;
-    }
-
-    m_requestId++;
-
-    if (m_requestStatus)
-    {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
-    }
-
-    if (reporting->name() == "battery")
-        enqueueRequest(device, endpoint->id(), CLUSTER_POWER_CONFIGURATION, readAttributesRequest(m_requestId, 0x0000, reporting->attributes()), "battery status request");
-
-    logInfo << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request finished successfully";
-    return true;
-}
-
-bool ZigBee::bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, bool unbind, bool manual)
-{
-    const Device &device = endpoint->device();
-    QString name = unbind ? "unbinding from " : "binding to ";
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
-
-    switch (address.length())
-    {
-        case 0: name.append("coordinator"); break;
-        case 2: name.append(QString::asprintf("group %d", qFromLittleEndian <quint16> (*(reinterpret_cast <const quint16*> (address.data()))))); break;
-
-        default:
-        {
-            const Device &device = m_devices->value(address);
-            name.append(QString::asprintf("device \"%s\" endpoint \"0x%02x\"", device.isNull() ? address.toHex(':').constData() : device->name().toUtf8().constData(), dstEndpointId ? dstEndpointId : 0x01)); break;
-            break;
-        }
-    }
-
-    if (!m_adapter->bindRequest(m_requestId, device->networkAddress(), endpoint->id(), clusterId, address, dstEndpointId, unbind))
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "request aborted";
-        return false;
-    }
-
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "timed out";
-        return false;
-    }
-
-    m_requestId++;
+    device->timer()->stop();
 
-    if (m_requestStatus)
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
-    }
+    logInfo << device << "manufacturer name is" << device->manufacturerName() << "and model name is" << device->modelName();
+    m_devices->setupDevice(device);
 
-    logInfo << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "finished successfully";
+    if (!device->firmware().isEmpty())
+        logInfo << device << "firmware is" << device->firmware();
 
-    if (manual)
-    {
-        Binding binding(new BindingObject(clusterId, address, dstEndpointId));
-        bool check = true;
+    if (!device->description().isEmpty())
+        logInfo << device << "identified as" << device->description();
 
-        for (int i = 0; i < endpoint->bindings().count(); i++)
-        {
-            const Binding &item = endpoint->bindings().at(i);
+    m_sequence = Sequence(new SequenceObject(device, SequenceType::Interview, RequestPriority::Alarm));
+    interviewQuirks(device);
+    configureDevice(device);
+    startSequence();
+}
 
-            if (!item->name().isEmpty() || item->clusterId() != binding->clusterId() || item->address() != binding->address() || item->endpointId() != binding->endpointId())
-                continue;
+void ZigBee::interviewError(const Device &device, const QString &reason)
+{
+    if (!device->timer()->isActive())
+        return;
 
-            if (unbind)
-            {
-                endpoint->bindings().removeAt(i);
-                m_devices->storeDatabase();
-            }
+    logWarning << device << "interview error:" << reason;
+    emit deviceEvent(device.data(), Event::interviewError);
 
-            check = false;
-            break;
-        }
+    device->timer()->stop();
+}
 
-        if (check)
+void ZigBee::configureDevice(const Device &device)
+{
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    {
+        for (int i = 0; i < it.value()->bindings().count(); i++)
         {
-            endpoint->bindings().append(binding);
-            m_devices->storeDatabase();
+            const Binding &binding = it.value()->bindings().at(i);
+            bindRequest(it.value(), binding->clusterId(), binding->address(), binding->endpointId());
         }
     }
 
-    return true;
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+        for (int i = 0; i < it.value()->reportings().count(); i++)
+            configureReporting(it.value(), it.value()->reportings().at(i));
 }
 
-bool ZigBee::groupRequest(const Endpoint &endpoint, quint16 groupId, bool remove, bool removeAll)
+void ZigBee::configureReporting(const Endpoint &endpoint, const Reporting &reporting)
 {
     const Device &device = endpoint->device();
-    QByteArray request;
-    QString name;
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+    QMap <QString, QVariant> options = device->options().value(device->options().contains("reporting") ? "reporting" : QString(reporting->name()).append("Reporting")).toMap();
+    QByteArray request = zclHeader(0x00, m_transactionId++, CMD_CONFIGURE_REPORTING);
 
-    if (removeAll)
-    {
-        m_replyId = m_requestId;
-        m_replyReceived = false;
-        request = zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x04);
-        name = "remove all groups request";
-    }
-    else
+    for (int i = 0; i < reporting->attributes().count(); i++)
     {
-        m_groupRequestFinished = false;
-        groupId = qToLittleEndian(groupId);
-        request = zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, remove ? 0x03 : 0x00).append(reinterpret_cast <char*> (&groupId), sizeof(groupId)).append(remove ? 0 : 1, 0x00);
-        name = QString("%1 group request").arg(remove ? "remove" : "add");
-    }
+        configureReportingStruct item;
 
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), CLUSTER_GROUPS, request))
-    {
-        logWarning << device << endpoint << name.toUtf8().constData() << "aborted";
-        return false;
-    }
+        item.direction = 0x00;
+        item.attributeId = qToLittleEndian(reporting->attributes().at(i));
+        item.dataType = reporting->dataType();
+        item.minInterval = qToLittleEndian <quint16> (options.contains("minInterval") ? options.value("minInterval").toInt() : reporting->minInterval());
+        item.maxInterval = qToLittleEndian <quint16> (options.contains("maxInterval") ? options.value("maxInterval").toInt() : reporting->maxInterval());
+        item.valueChange = qToLittleEndian <quint64> (options.contains("valueChange") ? options.value("valueChange").toInt() : reporting->valueChange());
 
-    if (removeAll ? !m_replyReceived : !m_groupRequestFinished && !m_adapter->waitForSignal(this, removeAll ? SIGNAL(replyReceived()) : SIGNAL(groupRequestFinished()), NETWORK_REQUEST_TIMEOUT))
-    {
-        logWarning << device << endpoint << name.toUtf8().constData() << "timed out";
-        return false;
+        request.append(reinterpret_cast <char*> (&item), sizeof(item) - sizeof(item.valueChange) + zclDataSize(item.dataType));
     }
 
-    m_requestId++;
+    enqueueRequest(device, QVariant::fromValue(ReportingRequest(new ReportingRequestObject(endpoint, reporting, request))), RequestType::Reporting, RequestPriority::Interactive);
+}
+
+void ZigBee::bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, bool unbind, bool manual)
+{
+    QString name = unbind ? "unbinding from " : "binding to ";
 
-    if (removeAll)
-    {
-        logInfo << device << endpoint << name.toUtf8().constData() << "finished successfully";
-        endpoint->groups().clear();
-        m_devices->storeDatabase();
-    }
-    else
+    switch (address.length())
     {
-        bool check = true;
-
-        if (!m_groupsUpdated)
-            return true;
+        case 0: name.append("coordinator"); break;
+        case 2: name.append(QString::asprintf("group %d", qFromLittleEndian <quint16> (*(reinterpret_cast <const quint16*> (address.data()))))); break;
 
-        for (int i = 0; i < endpoint->groups().count(); i++)
+        default:
         {
-            if (endpoint->groups().at(i) != groupId)
-                continue;
-
-            if (remove)
-            {
-                endpoint->groups().removeAt(i);
-                m_devices->storeDatabase();
-            }
-
-            check = false;
+            const Device &device = m_devices->value(DeviceList::deviceKey(address));
+            name.append(QString::asprintf("device \"%s\" endpoint \"0x%02x\"", device.isNull() ? address.toHex(':').constData() : device->name().toUtf8().constData(), dstEndpointId ? dstEndpointId : 0x01));
             break;
         }
-
-        if (check)
-        {
-            endpoint->groups().append(groupId);
-            m_devices->storeDatabase();
-        }
     }
 
-    return true;
+    enqueueRequest(endpoint->device(), QVariant::fromValue(BindingRequest(new BindingRequestObject(endpoint, clusterId, address, dstEndpointId, name, unbind, manual))), RequestType::Binding, RequestPriority::Interactive);
 }
 
-bool ZigBee::dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name)
+void ZigBee::groupRequest(const Endpoint &endpoint, quint16 groupId, bool remove, bool removeAll)
 {
-    const Device &device = endpoint->device();
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
-
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), clusterId, data))
-    {
-        logWarning << device << endpoint << name.toUtf8().constData() << "aborted";
-        return false;
-    }
+    quint8 transactionId = m_transactionId++;
+    QByteArray request;
+    QString name;
 
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
+    if (removeAll)
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "timed out";
-        return false;
+        request = zclHeader(FC_CLUSTER_SPECIFIC, transactionId, 0x04);
+        name = "remove all groups request";
     }
-
-    m_requestId++;
-
-    if (m_requestStatus)
+    else
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
+        quint16 value = qToLittleEndian(groupId);
+        request = zclHeader(FC_CLUSTER_SPECIFIC, transactionId, remove ? 0x03 : 0x00).append(reinterpret_cast <char*> (&value), sizeof(value)).append(remove ? 0 : 1, 0x00);
+        name = QString("%1 group request").arg(remove ? "remove" : "add");
     }
 
-    logWarning << device << endpoint << name.toUtf8().constData() << "finished successfully";
-    return true;
+    m_transactions.insert(transactionId, enqueueRequest(endpoint->device(), QVariant::fromValue(GroupRequest(new GroupRequestObject(endpoint, groupId, request, name, remove, removeAll))), RequestType::Group, RequestPriority::Interactive));
 }
 
 bool ZigBee::parseProperty(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 itemId, const QByteArray &data, bool command)
 {
     const Device &device = endpoint->device();
+    auto it = endpoint->clusterProperties().find(clusterId);
     bool check = false;
 
-    for (int i = 0; i < endpoint->properties().count(); i++)
-    {
-        const Property &property = endpoint->properties().at(i);
+    if (it == endpoint->clusterProperties().end())
+        return false;
 
-        if (property->clusters().contains(clusterId))
-        {
-            QVariant value = property->value();
+    for (int i = 0; i < it->count(); i++)
+    {
+        const Property &property = it->at(i);
+        QVariant value = property->value();
 
-            if (device->options().value("checkTransactionId").toBool() && property->transactionId() == transactionId)
-                continue;
+        if (device->options().value("checkTransactionId").toBool() && property->transactionId() == transactionId)
+            continue;
 
-            if (command)
-                property->parseCommand(clusterId, static_cast <quint8> (itemId), data);
-            else
-                property->parseAttribte(clusterId, itemId, data);
+        if (command)
+            property->parseCommand(clusterId, static_cast <quint8> (itemId), data);
+        else
+            property->parseAttribte(clusterId, itemId, data);
 
-            property->setTransactionId(transactionId);
-            check = true;
+        property->setTransactionId(transactionId);
+        check = true;
 
-            while (!property->queue().isEmpty())
-            {
-                const PropertyRequest &request = property->queue().dequeue();
-                enqueueRequest(device, endpoint->id(), request.clusterId, request.data);
-            }
+        while (!property->queue().isEmpty())
+        {
+            const PropertyRequest &request = property->queue().dequeue();
+            enqueueRequest(device, endpoint->id(), request.clusterId, request.data, RequestPriority::Interactive);
+        }
 
-            if (property->timeout())
-                property->setTime(QDateTime::currentSecsSinceEpoch());
+        if (property->timeout())
+            property->setTime(QDateTime::currentSecsSinceEpoch());
 
-            if (m_debounce && property->value() == value)
-                continue;
+        if (m_debounce && property->value() == value)
+            continue;
 
-            m_devices->storeProperties();
-            endpoint->setUpdated(true);
-        }
+        m_devices->storeProperties();
+        endpoint->setUpdated(true);
     }
 
     return check;
@@ -1039,7 +1357,7 @@ void ZigBee::parseAttribute(const Endpoint &endpoint, quint16 clusterId, quint8
             QDateTime now = QDateTime::currentDateTime();
             quint32 value = qToLittleEndian <quint32> (now.toTime_t() + now.offsetFromUtc() - TIME_OFFSET);
             logDebug(m_debug) << device << "requested EFEKTA time synchronization";
-            enqueueRequest(device, endpoint->id(), CLUSTER_TIME, writeAttributeRequest(m_requestId, 0x0000, 0x0000, DATA_TYPE_UTC_TIME, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))));
+            enqueueReply(device, endpoint->id(), CLUSTER_TIME, writeAttributeRequest(m_transactionId++, 0x0000, 0x0000, DATA_TYPE_UTC_TIME, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))));
             return;
         }
 
@@ -1180,6 +1498,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 {
                         const groupControlResponseStruct *response = reinterpret_cast <const groupControlResponseStruct*> (payload.constData());
                         quint16 groupId = qFromLittleEndian(response->groupId);
+                        const Request &request = m_transactions.value(transactionId);
 
                         switch (response->status)
                         {
@@ -1193,9 +1512,25 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                                 break;
                         }
 
-                        m_groupRequestFinished = true;
-                        m_groupsUpdated = response->status == STATUS_SUCCESS ? true : false;
-                        emit groupRequestFinished();
+                        if (request.isNull() || request->type() != RequestType::Group || request->status() != RequestStatus::Sent || qvariant_cast <GroupRequest> (request->data())->endpoint() != endpoint)
+                            break;
+
+                        if (response->status == STATUS_SUCCESS)
+                        {
+                            const GroupRequest &group = qvariant_cast <GroupRequest> (request->data());
+                            int index = endpoint->groups().indexOf(group->groupId());
+
+                            if (group->remove() && index >= 0)
+                                endpoint->groups().removeAt(index);
+                            else if (!group->remove() && index < 0)
+                                endpoint->groups().append(group->groupId());
+
+                            m_devices->storeDatabase();
+                        }
+
+                        request->setStatus(RequestStatus::Finished);
+                        updateSequence(request, true);
+                        removeRequest(request);
                         break;
                 }
 
@@ -1251,7 +1586,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     response.imageSize = qToLittleEndian(device->otaData().imageSize());
 
                     logInfo << device << "OTA upgrade started...";
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x02).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x02).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Alarm);
                     emit deviceEvent(device.data(), Event::otaUpgradeStarted);
                     break;
                 }
@@ -1288,7 +1623,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
 
                     device->otaData().setProgress(static_cast <double> (qFromLittleEndian(request->fileOffset) + buffer.length()) / device->otaData().imageSize() * 100);
                     logInfo << device << "OTA upgrade progress is" << QString::asprintf("%.2f%%", device->otaData().progress()).toUtf8().constData();
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x05).append(reinterpret_cast <char*> (&response), sizeof(response)).append(buffer));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x05).append(reinterpret_cast <char*> (&response), sizeof(response)).append(buffer), RequestPriority::Alarm);
                     break;
                 }
 
@@ -1319,7 +1654,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     device->otaData().setProgress(0);
                     device->otaData().setUpgrade(false);
 
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x07).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x07).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Alarm);
                     emit deviceEvent(device.data(), Event::otaUpgradeFinished);
                     break;
                 }
@@ -1340,7 +1675,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 logDebug(m_debug) << device << "requested IAS Zone enroll";
                 response.responseCode = 0x00;
                 response.zoneId = IAS_ZONE_ID;
-                enqueueRequest(device, endpoint->id(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x00).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                enqueueRequest(device, endpoint->id(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x00).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Alarm);
                 return;
             }
 
@@ -1360,13 +1695,13 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     response.payloadSize = qToLittleEndian <quint16> (8);
                     response.utcTimestamp = qToBigEndian(value);
                     response.localTimestamp = qToBigEndian(value + now.offsetFromUtc());
-                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x24).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x24).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Alarm);
                     return;
                 }
 
                 case 0x25:
                 {
-                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x25).append(QByteArray::fromHex("010001")));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x25).append(QByteArray::fromHex("010001")), RequestPriority::Alarm);
                     return;
                 }
             }
@@ -1448,7 +1783,7 @@ void ZigBee::globalCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 response.append(1, static_cast <char> (STATUS_UNSUPPORTED_ATTRIBUTE));
             }
 
-            enqueueRequest(device, endpoint->id(), clusterId, response);
+            enqueueReply(device, endpoint->id(), clusterId, response);
             break;
         }
 
@@ -1531,13 +1866,13 @@ void ZigBee::touchLinkReset(const QByteArray &ieeeAddress, quint8 channel)
     if (!m_adapter->setInterPanChannel(channel))
         return;
 
-    if (!m_adapter->broadcastInterPanRequest(m_requestId, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x00).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload)))))
+    if (!m_adapter->broadcastInterPanRequest(adapterTag(), CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_transactionId++, 0x00).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload)))))
     {
         logWarning << "TouchLink scan request failed";
         return;
     }
 
-    if (!m_adapter->unicastInterPanRequest(m_requestId, ieeeAddress, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x07).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload.transactionId)))))
+    if (!m_adapter->unicastInterPanRequest(adapterTag(), ieeeAddress, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_transactionId++, 0x07).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload.transactionId)))))
     {
         logWarning << "TouchLink reset request failed";
         return;
@@ -1548,7 +1883,7 @@ void ZigBee::touchLinkReset(const QByteArray &ieeeAddress, quint8 channel)
 
 void ZigBee::touchLinkScan(void)
 {
-    QByteArray request = zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x00);
+    QByteArray request = zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_transactionId++, 0x00);
     touchLinkScanStruct payload;
     QEventLoop loop;
     QTimer timer;
@@ -1567,7 +1902,7 @@ void ZigBee::touchLinkScan(void)
         if (!m_adapter->setInterPanChannel(m_interPanChannel))
             return;
 
-        if (!m_adapter->broadcastInterPanRequest(m_requestId, CLUSTER_TOUCHLINK, request))
+        if (!m_adapter->broadcastInterPanRequest(adapterTag(), CLUSTER_TOUCHLINK, request))
         {
             logWarning << "TouchLink scan request failed";
             return;
@@ -1613,22 +1948,18 @@ void ZigBee::rejoinHandler(const Device &device)
                 configureReporting(it.value(), it.value()->reportings().at(i));
 
     if (device->options().value("tuyaDataQuery").toBool())
-        enqueueRequest(device, 0x01, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x03), "data query request");
+        enqueueRequest(device, 0x01, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_transactionId++, 0x03), RequestPriority::Maintenance, "data query request");
 }
 
 void ZigBee::restoreGroups(const Device &device)
 {
+    m_sequence = Sequence(new SequenceObject(device, SequenceType::Groups, RequestPriority::Maintenance));
+
     for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-    {
         for (int i = 0; i < it.value()->groups().count(); i++)
-        {
-            if (groupRequest(it.value(), it.value()->groups().at(i)))
-                continue;
+            groupRequest(it.value(), it.value()->groups().at(i));
 
-            logWarning << device << "groups restore failed";
-            return;
-        }
-    }
+    startSequence();
 }
 
 void ZigBee::otaError(const Endpoint &endpoint, quint16 manufacturerCode, quint8 transactionId, quint8 commandId, const QString &error, bool response)
@@ -1642,7 +1973,7 @@ void ZigBee::otaError(const Endpoint &endpoint, quint16 manufacturerCode, quint8
     }
 
     if (response)
-        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, commandId == 0x01 ? 0x02 : 0x05, manufacturerCode).append(STATUS_NO_IMAGE_AVAILABLE));
+        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, commandId == 0x01 ? 0x02 : 0x05, manufacturerCode).append(STATUS_NO_IMAGE_AVAILABLE), RequestPriority::Alarm);
 
     device->otaData().setUpgrade(false);
 }
@@ -1658,17 +1989,33 @@ void ZigBee::blink(quint16 timeout)
 
 void ZigBee::adapterReset(void)
 {
+    QList <Request> list = m_requests.values();
+
+    for (int i = 0; i < list.count(); i++)
+    {
+        const Request &request = list.at(i);
+
+        if (request->status() != RequestStatus::Sent)
+            continue;
+
+        request->setStatus(RequestStatus::Aborted);
+        updateSequence(request, false);
+        removeRequest(request);
+    }
+
+    m_replies.clear();
+    m_replyTags.clear();
     m_requestTimer->stop();
 }
 
 void ZigBee::coordinatorReady(void)
 {
-    Device device = m_devices->value(m_adapter->ieeeAddress());
+    Device device = m_devices->value(DeviceList::deviceKey(m_adapter->ieeeAddress()));
 
     if (device.isNull())
     {
         device = Device(new DeviceObject(m_adapter->ieeeAddress(), 0x0000, "HOMEd Coordinator"));
-        m_devices->insert(device->ieeeAddress(), device);
+        m_devices->addDevice(device);
     }
 
     for (auto it = m_devices->begin(); it != m_devices->end(); it++)
@@ -1676,10 +2023,12 @@ void ZigBee::coordinatorReady(void)
         if (it.value()->removed()) // fix for old-style removed devices
             continue;
 
-        if (it.value()->logicalType() == LogicalType::Coordinator && it.key() != device->ieeeAddress())
+        if (it.value()->logicalType() == LogicalType::Coordinator && it.value() != device)
         {
-            logWarning << "Coordinator" << it.value()->ieeeAddress().toHex(':') << "removed";
-            m_devices->erase(it++);
+            Device coordinator = it.value();
+            logWarning << "Coordinator" << coordinator->ieeeAddress().toHex(':') << "removed";
+            it++;
+            m_devices->eraseDevice(coordinator);
         }
 
         if (it == m_devices->end())
@@ -1708,7 +2057,10 @@ void ZigBee::coordinatorReady(void)
     logInfo << "Coordinator ready, address:" << device->ieeeAddress().toHex(':');
     m_adapter->setPermitJoin(m_devices->permitJoin());
 
-    if (!m_requests.isEmpty())
+    m_requestWindow = m_adapter->requestLimit() > 1 ? m_adapter->requestLimit() / 2 : 1;
+    m_requestCredit = 0;
+
+    if (!m_queues.isEmpty())
         m_requestTimer->start();
 
     if (!m_neignborsTimer->isActive())
@@ -1742,14 +2094,15 @@ void ZigBee::permitJoinUpdated(bool enabled)
 
 void ZigBee::deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress)
 {
-    auto it = m_devices->find(ieeeAddress);
+    auto it = m_devices->find(DeviceList::deviceKey(ieeeAddress));
 
     if (it == m_devices->end())
     {
         if (!networkAddress)
             return;
 
-        it = m_devices->insert(ieeeAddress, Device(new DeviceObject(ieeeAddress, networkAddress)));
+        m_devices->addDevice(Device(new DeviceObject(ieeeAddress, networkAddress)));
+        it = m_devices->find(DeviceList::deviceKey(ieeeAddress));
 
         logInfo << it.value() << "joined network with address" << QString::asprintf("0x%04x", networkAddress);
         it.value()->setDiscovery(m_discovery);
@@ -1772,7 +2125,7 @@ void ZigBee::deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress)
     if (it.value()->networkAddress() != networkAddress)
     {
         logInfo << it.value() << "network address updated";
-        it.value()->setNetworkAddress(networkAddress);
+        m_devices->setNetworkAddress(it.value(), networkAddress);
     }
 
     if (it.value()->interviewStatus() != InterviewStatus::Finished && !it.value()->timer()->isActive())
@@ -1786,7 +2139,7 @@ void ZigBee::deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress)
 
 void ZigBee::deviceLeft(const QByteArray &ieeeAddress)
 {
-    auto it = m_devices->find(ieeeAddress);
+    auto it = m_devices->find(DeviceList::deviceKey(ieeeAddress));
 
     if (it == m_devices->end() || it.value()->removed() || it.value()->logicalType() == LogicalType::Coordinator)
         return;
@@ -1928,7 +2281,7 @@ void ZigBee::zdoMessageReveived(quint16 networkAddress, quint16 clusterId, const
                 if (response->total > response->index + response->count)
                 {
                     device->setLqiRequestIndex(response->index + response->count);
-                    enqueueRequest(device, RequestType::LQI);
+                    enqueueRequest(device, RequestType::LQI, RequestPriority::Maintenance);
                 }
 
                 break;
@@ -1978,9 +2331,9 @@ void ZigBee::zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint
         data = payload.mid(3);
     }
 
-    request = m_requests.value(transactionId);
+    request = m_transactions.value(transactionId);
 
-    if (!request.isNull() && request->type() == RequestType::Data && qvariant_cast <DataRequest> (request->data())->debug())
+    if (!request.isNull() && request->type() == RequestType::Data && qvariant_cast <DataRequest> (request->data())->device() == device && qvariant_cast <DataRequest> (request->data())->debug())
     {
         QJsonObject json = {{"endpointId", endpointId}, {"clusterId", clusterId}, {"commandId", commandId}, {"payload", data.toHex(':').constData()}};
 
@@ -1996,14 +2349,7 @@ void ZigBee::zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint
         globalCommandReceived(endpoint, clusterId, manufacturerCode, transactionId, commandId, data);
 
     if (device->interviewStatus() == InterviewStatus::Finished && (frameControl & FC_CLUSTER_SPECIFIC || commandId == CMD_REPORT_ATTRIBUTES) && !(frameControl & FC_DISABLE_DEFAULT_RESPONSE))
-    {
-        defaultResponseStruct response;
-
-        response.commandId = commandId;
-        response.status = 0x00;
-
-        enqueueRequest(device, endpoint->id(), clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_DEFAULT_RESPONSE, manufacturerCode).append(QByteArray(reinterpret_cast <char*> (&response), sizeof(response))));
-    }
+        enqueueReply(device, endpoint->id(), clusterId, defaultResponse(transactionId, manufacturerCode, commandId, STATUS_SUCCESS));
 
     if (endpoint->updated() || (endpoint->properties().isEmpty() && endpoint->inClusters().contains(CLUSTER_BASIC)))
         emit endpointUpdated(device.data(), endpoint->id());
@@ -2024,16 +2370,23 @@ void ZigBee::rawMessageReveived(const QByteArray &ieeeAddress, quint16 clusterId
 
 void ZigBee::requestFinished(quint8 id, quint8 status)
 {
-    auto it = m_requests.find(id);
+    auto it = m_tags.contains(id) ? m_requests.find(m_tags.value(id)) : m_requests.end();
 
-    if (id == m_replyId)
+    if (m_replyTags.contains(id))
     {
-        m_requestStatus = status;
-        m_replyReceived = true;
-        emit replyReceived();
+        removeReply(id);
+        return;
     }
 
-    if (it == m_requests.end() || it.value()->status() == RequestStatus::Finished)
+    if (it == m_requests.end() || it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted)
+        return;
+
+    if (m_adapter->congestionStatus(status) || m_adapter->macStatus(status))
+        updateWindow(true);
+    else if (!status && QDateTime::currentMSecsSinceEpoch() - it.value()->time() < REQUEST_CONFIRM_THRESHOLD)
+        updateWindow(false);
+
+    if ((m_adapter->congestionStatus(status) || m_adapter->deliveryStatus(status)) && retryRequest(it.value(), m_adapter->deliveryStatus(status)))
         return;
 
     switch (it.value()->type())
@@ -2065,8 +2418,95 @@ void ZigBee::requestFinished(quint8 id, quint8 status)
             }
 
             if (!request->action()->attributes().isEmpty() && !device->options().value("skipAttributeRead").toBool())
-                enqueueRequest(device, request->endpointId(), request->clusterId(), readAttributesRequest(m_requestId, request->manufacturerCode(), request->action()->attributes()));
+                enqueueRequest(device, request->endpointId(), request->clusterId(), readAttributesRequest(m_transactionId++, request->manufacturerCode(), request->action()->attributes()), RequestPriority::Interactive);
+
+            break;
+        }
+
+        case RequestType::Binding:
+        {
+            const BindingRequest &request = qvariant_cast <BindingRequest> (it.value()->data());
+            const Endpoint &endpoint = request->endpoint();
+            const Device &device = endpoint->device();
+            bool check = true;
+
+            if (status)
+            {
+                logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", request->clusterId()) << request->name().toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", status);
+                break;
+            }
+
+            logInfo << device << endpoint << "cluster" << QString::asprintf("0x%04x", request->clusterId()) << request->name().toUtf8().constData() << "finished successfully";
+
+            if (!request->manual())
+                break;
+
+            for (int i = 0; i < endpoint->bindings().count(); i++)
+            {
+                const Binding &item = endpoint->bindings().at(i);
+
+                if (!item->name().isEmpty() || item->clusterId() != request->clusterId() || item->address() != request->address() || item->endpointId() != request->dstEndpointId())
+                    continue;
+
+                if (request->unbind())
+                {
+                    endpoint->bindings().removeAt(i);
+                    m_devices->storeDatabase();
+                }
+
+                check = false;
+                break;
+            }
+
+            if (check)
+            {
+                endpoint->bindings().append(Binding(new BindingObject(request->clusterId(), request->address(), request->dstEndpointId())));
+                m_devices->storeDatabase();
+            }
+
+            break;
+        }
+
+        case RequestType::Group:
+        {
+            const GroupRequest &request = qvariant_cast <GroupRequest> (it.value()->data());
+            const Endpoint &endpoint = request->endpoint();
+            const Device &device = endpoint->device();
+
+            if (status)
+            {
+                logWarning << device << endpoint << request->name().toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", status);
+                break;
+            }
+
+            if (!request->removeAll())
+            {
+                m_tags.remove(id);
+                return;
+            }
+
+            logInfo << device << endpoint << request->name().toUtf8().constData() << "finished successfully";
+            endpoint->groups().clear();
+            m_devices->storeDatabase();
+            break;
+        }
+
+        case RequestType::Reporting:
+        {
+            const ReportingRequest &request = qvariant_cast <ReportingRequest> (it.value()->data());
+            const Endpoint &endpoint = request->endpoint();
+            const Device &device = endpoint->device();
+
+            if (status)
+            {
+                logWarning << device << endpoint << request->reporting()->name().toUtf8().constData() << "reporting configuration request failed, status code:" << QString::asprintf("0x%02x", status);
+                break;
+            }
 
+            if (request->reporting()->name() == "battery")
+                enqueueRequest(device, endpoint->id(), CLUSTER_POWER_CONFIGURATION, readAttributesRequest(m_transactionId++, 0x0000, request->reporting()->attributes()), RequestPriority::Maintenance, "battery status request");
+
+            logInfo << device << endpoint << request->reporting()->name().toUtf8().constData() << "reporting configuration request finished successfully";
             break;
         }
 
@@ -2092,90 +2532,124 @@ void ZigBee::requestFinished(quint8 id, quint8 status)
             break;
     }
 
-    it.value()->setStatus(RequestStatus::Finished);
+    Request request = it.value();
+
+    request->setStatus(RequestStatus::Finished);
+    updateSequence(request, !status);
+    removeRequest(request);
+}
+
+void ZigBee::updateStatus(const QJsonObject &json)
+{
+    QJsonObject data = json;
+
+    if (m_adapter)
+        data.insert("transport", m_adapter->statistics());
+
+    emit statusUpdated(data);
 }
 
 void ZigBee::handleRequests(void)
 {
-    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    m_requestTimer->stop();
+
+    while (!m_replies.isEmpty() && m_tags.count() + m_replyTags.count() < 0xFF)
     {
-        if (it.value()->status() != RequestStatus::Pending)
-            continue;
+        ReplyRequest reply = m_replies.dequeue();
+        quint8 tag = adapterTag();
+        qint64 time = QDateTime::currentMSecsSinceEpoch();
+
+        m_replyTags.insert(tag, time);
+        m_adapter->setRequestParameters(reply.device->ieeeAddress(), reply.device->batteryPowered());
 
-        switch (it.value()->type())
+        if (!m_adapter->unicastRequest(tag, reply.device->networkAddress(), 0x01, reply.endpointId, reply.clusterId, reply.data))
         {
-            case RequestType::Data:
-            {
-                const DataRequest &request = qvariant_cast <DataRequest> (it.value()->data());
-                const Device &device = request->device();
+            logWarning << reply.device << "cluster" << QString::asprintf("0x%04x", reply.clusterId) << "reply aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
+            m_replyTags.remove(tag);
+            continue;
+        }
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+        QTimer::singleShot(NETWORK_REQUEST_TIMEOUT, this, [this, tag, time] () { if (m_replyTags.value(tag) == time) removeReply(tag); });
+    }
 
-                if (!m_adapter->unicastRequest(it.key(), device->networkAddress(), 0x01, request->endpointId(), request->clusterId(), request->data()))
-                {
-                    logWarning << device << (!request->name().isEmpty() ? request->name().toUtf8().constData() : "data request") << "aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
-                    it.value()->setStatus(RequestStatus::Aborted);
-                }
+    while (m_tags.count() + m_replyTags.count() < m_requestWindow)
+    {
+        qint64 time = QDateTime::currentMSecsSinceEpoch();
+        auto it = m_queues.begin();
+        Device device;
+        Request request;
 
-                break;
-            }
+        while (it != m_queues.end() && request.isNull())
+        {
+            QQueue <Device> &queue = it.value();
 
-            case RequestType::Leave:
+            for (int count = queue.count(); count && request.isNull(); count--)
             {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
+                bool pending = false;
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+                device = queue.dequeue();
 
-                if (!m_adapter->leaveRequest(it.key(), device->networkAddress()))
+                for (int i = 0; i < device->requests().count(); i++)
                 {
-                    logWarning << device << "leave request aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
-                    it.value()->setStatus(RequestStatus::Aborted);
-                }
+                    Request item = m_requests.value(device->requests().at(i));
 
-                break;
-            }
+                    if (item.isNull() || item->status() != RequestStatus::Pending)
+                    {
+                        device->requests().removeAt(i--);
+                        continue;
+                    }
 
-            case RequestType::LQI:
-            {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
+                    if (item->deadline() && item->deadline() < time)
+                    {
+                        device->requests().removeAt(i--);
+                        expireRequest(item);
+                        continue;
+                    }
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+                    if (item->priority() != it.key())
+                        continue;
 
-                if (!m_adapter->lqiRequest(it.key(), device->networkAddress(), device->lqiRequestIndex()))
-                    it.value()->setStatus(RequestStatus::Aborted);
+                    if (request.isNull() && (item->sequence().isNull() || item->sequence()->requests().head() == item))
+                    {
+                        device->requests().removeAt(i--);
+                        request = item;
+                        continue;
+                    }
 
-                break;
+                    pending = true;
+                }
+
+                if (pending)
+                    queue.enqueue(device);
             }
 
-            case RequestType::Interview:
+            if (queue.isEmpty())
             {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
-
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-
-                if (!interviewRequest(it.key(), device))
-                    it.value()->setStatus(RequestStatus::Aborted);
-
-                break;
+                it = m_queues.erase(it);
+                continue;
             }
+
+            it++;
         }
 
-        if (it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted)
-            continue;
+        if (request.isNull())
+            break;
 
-        it.value()->setStatus(RequestStatus::Sent);
+        sendRequest(device, request);
     }
 
-    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    auto it = m_transactions.begin();
+
+    while (it != m_transactions.end())
     {
-        if (it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted)
-            m_requests.erase(it++);
+        if (it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted || it.value()->status() == RequestStatus::Expired)
+        {
+            it = m_transactions.erase(it);
+            continue;
+        }
 
-        if (it == m_requests.end())
-            break;
+        it++;
     }
-
-    m_requestTimer->stop();
 }
 
 void ZigBee::updateNeighbors(void)
@@ -2186,7 +2660,7 @@ void ZigBee::updateNeighbors(void)
             continue;
 
         it.value()->setLqiRequestIndex(0);
-        enqueueRequest(it.value(), RequestType::LQI);
+        enqueueRequest(it.value(), RequestType::LQI, RequestPriority::Maintenance);
     }
 }
 
@@ -2205,7 +2679,7 @@ void ZigBee::pingDevices(void)
         {
             if (it.value()->inClusters().contains(CLUSTER_BASIC))
             {
-                enqueueRequest(device, it.key(), CLUSTER_BASIC, readAttributesRequest(m_requestId, 0x0000, {0x0000}));
+                enqueueRequest(device, it.key(), CLUSTER_BASIC, readAttributesRequest(m_transactionId++, 0x0000, {0x0000}), RequestPriority::Maintenance);
                 break;
             }
         }
@@ -2214,7 +2688,7 @@ void ZigBee::pingDevices(void)
 
 void ZigBee::interviewTimeout(void)
 {
-    Device device = m_devices->value(reinterpret_cast <DeviceObject*> (sender()->parent())->ieeeAddress());
+    Device device = m_devices->value(DeviceList::deviceKey(reinterpret_cast <DeviceObject*> (sender()->parent())->ieeeAddress()));
 
     if (device->interviewStatus() == InterviewStatus::Finished)
         return;
@@ -2224,7 +2698,7 @@ void ZigBee::interviewTimeout(void)
 
 void ZigBee::pollRequest(EndpointObject *endpoint, const Poll &poll)
 {
-    enqueueRequest(endpoint->device(), endpoint->id(), poll->clusterId(), readAttributesRequest(m_requestId, 0x0000, poll->attributes()));
+    enqueueRequest(endpoint->device(), endpoint->id(), poll->clusterId(), readAttributesRequest(m_transactionId++, 0x0000, poll->attributes()), RequestPriority::Maintenance);
 }
 
 void ZigBee::updateStatusLed(void)
@@ -4,6 +4,10 @@
 #define UPDATE_NEIGHBORS_INTERVAL       3600000
 #define PING_DEVICES_INTERVAL           300000
 #define NETWORK_REQUEST_TIMEOUT         8000
+#define REQUEST_CONFIRM_THRESHOLD       1000
+#define REQUEST_RETRY_DELAY             250
+#define MAX_REQUEST_RETRIES             3
+#define MAX_READ_ATTRIBUTES             8
 #define DEVICE_REJOIN_TIMEOUT           5000
 #define INTER_PAN_CHANNEL_TIMEOUT       100
 #define STATUS_LED_TIMEOUT              500
@@ -18,23 +22,61 @@
 class DataRequestObject;
 typedef QSharedPointer <DataRequestObject> DataRequest;
 
+class BindingRequestObject;
+typedef QSharedPointer <BindingRequestObject> BindingRequest;
+
+class GroupRequestObject;
+typedef QSharedPointer <GroupRequestObject> GroupRequest;
+
+class ReportingRequestObject;
+typedef QSharedPointer <ReportingRequestObject> ReportingRequest;
+
 class RequestObject;
 typedef QSharedPointer <RequestObject> Request;
 
+class SequenceObject;
+typedef QSharedPointer <SequenceObject> Sequence;
+
 enum class RequestType
 {
     Data,
+    Binding,
+    Group,
+    Reporting,
     Leave,
     LQI,
     Interview
 };
 
+enum class RequestPriority
+{
+    Interactive,
+    Alarm,
+    Maintenance
+};
+
 enum class RequestStatus
 {
     Pending,
     Sent,
     Finished,
-    Aborted
+    Aborted,
+    Expired
+};
+
+enum class SequenceType
+{
+    Interview,
+    Configure,
+    Groups
+};
+
+struct ReplyRequest
+{
+    Device device;
+    quint8 endpointId;
+    quint16 clusterId;
+    QByteArray data;
 };
 
 class DataRequestObject
@@ -43,16 +85,20 @@ class DataRequestObject
 public:
 
     DataRequestObject(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, const QString &name, bool debug, quint16 manufacturerCode, const Action &action) :
-        m_device(device), m_endpointId(endpointId), m_clusterId(clusterId), m_data(data), m_name(name), m_debug(debug), m_manufacturerCode(manufacturerCode), m_action(action) {}
+        m_device(device), m_endpointId(endpointId), m_clusterId(clusterId), m_data(data), m_name(name), m_debug(debug), m_absolute(false), m_manufacturerCode(manufacturerCode), m_action(action) {}
 
     inline Device device(void) { return m_device; }
     inline quint8 endpointId(void) { return m_endpointId; }
     inline quint16 clusterId(void) { return m_clusterId; }
     inline QByteArray data(void) { return m_data; }
+    inline void setData(const QByteArray &value) { m_data = value; }
 
     inline QString name(void) { return m_name; }
     inline bool debug(void) { return m_debug; }
 
+    inline bool absolute(void) { return m_absolute; }
+    inline void setAbsolute(bool value) { m_absolute = value; }
+
     inline quint16 manufacturerCode(void) { return m_manufacturerCode; }
     inline Action &action(void) { return m_action; }
 
@@ -64,32 +110,160 @@ private:
     QByteArray m_data;
 
     QString m_name;
-    bool m_debug;
+    bool m_debug, m_absolute;
 
     quint16 m_manufacturerCode;
     Action m_action;
 
 };
 
+class BindingRequestObject
+{
+
+public:
+
+    BindingRequestObject(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, const QString &name, bool unbind, bool manual) :
+        m_endpoint(endpoint), m_clusterId(clusterId), m_address(address), m_dstEndpointId(dstEndpointId), m_name(name), m_unbind(unbind), m_manual(manual) {}
+
+    inline Endpoint endpoint(void) { return m_endpoint; }
+    inline quint16 clusterId(void) { return m_clusterId; }
+    inline QByteArray address(void) { return m_address; }
+    inline quint8 dstEndpointId(void) { return m_dstEndpointId; }
+    inline QString name(void) { return m_name; }
+
+    inline bool unbind(void) { return m_unbind; }
+    inline bool manual(void) { return m_manual; }
+
+private:
+
+    Endpoint m_endpoint;
+    quint16 m_clusterId;
+    QByteArray m_address;
+    quint8 m_dstEndpointId;
+    QString m_name;
+
+    bool m_unbind, m_manual;
+
+};
+
+class GroupRequestObject
+{
+
+public:
+
+    GroupRequestObject(const Endpoint &endpoint, quint16 groupId, const QByteArray &data, const QString &name, bool remove, bool removeAll) :
+        m_endpoint(endpoint), m_groupId(groupId), m_data(data), m_name(name), m_remove(remove), m_removeAll(removeAll) {}
+
+    inline Endpoint endpoint(void) { return m_endpoint; }
+    inline quint16 groupId(void) { return m_groupId; }
+    inline QByteArray data(void) { return m_data; }
+    inline QString name(void) { return m_name; }
+
+    inline bool remove(void) { return m_remove; }
+    inline bool removeAll(void) { return m_removeAll; }
+
+private:
+
+    Endpoint m_endpoint;
+    quint16 m_groupId;
+    QByteArray m_data;
+    QString m_name;
+
+    bool m_remove, m_removeAll;
+
+};
+
+class ReportingRequestObject
+{
+
+public:
+
+    ReportingRequestObject(const Endpoint &endpoint, const Reporting &reporting, const QByteArray &data) :
+        m_endpoint(endpoint), m_reporting(reporting), m_data(data) {}
+
+    inline Endpoint endpoint(void) { return m_endpoint; }
+    inline Reporting reporting(void) { return m_reporting; }
+    inline QByteArray data(void) { return m_data; }
+
+private:
+
+    Endpoint m_endpoint;
+    Reporting m_reporting;
+    QByteArray m_data;
+
+};
+
 class RequestObject
 {
 
 public:
 
-    RequestObject(const QVariant &data, RequestType type) :
-        m_data(data), m_type(type), m_status(RequestStatus::Pending) {}
+    RequestObject(const Device &device, const QVariant &data, RequestType type, RequestPriority priority) :
+        m_device(device), m_data(data), m_type(type), m_priority(priority), m_status(RequestStatus::Pending), m_id(0), m_tag(0), m_retries(0), m_routeDiscovery(false), m_time(0), m_deadline(0) {}
 
+    inline Device device(void) { return m_device; }
     inline QVariant data(void) { return m_data; }
     inline RequestType type(void) { return m_type; }
+    inline RequestPriority priority(void) { return m_priority; }
 
     inline RequestStatus status(void) { return m_status; }
     inline void setStatus(RequestStatus value) { m_status = value; }
 
+    inline quint16 id(void) { return m_id; }
+    inline void setId(quint16 value) { m_id = value; }
+
+    inline quint8 tag(void) { return m_tag; }
+    inline void setTag(quint8 value) { m_tag = value; }
+
+    inline quint8 retries(void) { return m_retries; }
+    inline void setRetries(quint8 value) { m_retries = value; }
+
+    inline bool routeDiscovery(void) { return m_routeDiscovery; }
+    inline void setRouteDiscovery(bool value) { m_routeDiscovery = value; }
+
+    inline qint64 time(void) { return m_time; }
+    inline void setTime(qint64 value) { m_time = value; }
+
+    inline qint64 deadline(void) { return m_deadline; }
+    inline void setDeadline(qint64 value) { m_deadline = value; }
+
+    inline Sequence sequence(void) { return m_sequence; }
+    inline void setSequence(const Sequence &value) { m_sequence = value; }
+
 private:
 
+    Device m_device;
     QVariant m_data;
     RequestType m_type;
+    RequestPriority m_priority;
     RequestStatus m_status;
+    quint16 m_id;
+    quint8 m_tag, m_retries;
+    bool m_routeDiscovery;
+    qint64 m_time, m_deadline;
+    Sequence m_sequence;
+
+};
+
+class SequenceObject
+{
+
+public:
+
+    SequenceObject(const Device &device, SequenceType type, RequestPriority priority) :
+        m_device(device), m_type(type), m_priority(priority) {}
+
+    inline Device device(void) { return m_device; }
+    inline SequenceType type(void) { return m_type; }
+    inline RequestPriority priority(void) { return m_priority; }
+    inline QQueue <Request> &requests(void) { return m_requests; }
+
+private:
+
+    Device m_device;
+    SequenceType m_type;
+    RequestPriority m_priority;
+    QQueue <Request> m_requests;
 
 };
 
@@ -157,28 +331,54 @@ private:
     DeviceList *m_devices;
 
     QMetaEnum m_events;
-    quint8 m_requestId, m_requestStatus, m_replyId, m_interPanChannel;
-    bool m_replyReceived, m_groupRequestFinished, m_groupsUpdated, m_interPanLock;
+    quint16 m_requestId;
+    quint8 m_transactionId, m_tagId, m_requestWindow, m_requestCredit, m_interPanChannel;
+    bool m_interPanLock;
 
     QString m_statusLedPin, m_blinkLedPin;
-    bool m_debounce, m_discovery, m_cloud, m_debug;
-
-    QMap <quint8, Request> m_requests;
-
-    void enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, const QString &name = QString(), bool debug = false, quint16 manufacturerCode = 0, const Action &action = Action());
-    void enqueueRequest(const Device &device, RequestType type);
+    bool m_debounce, m_discovery, m_cloud, m_debug, m_rediscovery;
+
+    QMap <quint16, Request> m_requests;
+    QMap <quint8, quint16> m_tags;
+    QMap <quint8, qint64> m_replyTags;
+    QMap <quint8, Request> m_transactions;
+    QQueue <ReplyRequest> m_replies;
+    QMap <RequestPriority, qint64> m_deadlines;
+    QMap <RequestPriority, QQueue <Device>> m_queues;
+    QMap <QString, Action> m_groupActions;
+    Sequence m_sequence;
+
+    Request enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, RequestPriority priority, const QString &name = QString(), bool debug = false, quint16 manufacturerCode = 0, const Action &action = Action());
+    Request enqueueRequest(const Device &device, RequestType type, RequestPriority priority);
+    Request enqueueRequest(const Device &device, const QVariant &data, RequestType type, RequestPriority priority);
+    void enqueueReply(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data);
+    Request mergeRequest(const Device &device, const DataRequest &request, RequestPriority priority);
+    Request pendingAction(const Device &device, quint8 endpointId, const Action &action, const QString &name);
+    qint64 requestDeadline(const Device &device, RequestPriority priority);
+    void removeRequest(const Request &request);
+    void removeReply(quint8 tag);
+    void sendRequest(const Device &device, const Request &request);
+    void updateWindow(bool congestion);
+    bool retryRequest(const Request &request, bool route);
+    void requeueRequest(const Request &request);
+    quint8 adapterTag(void);
+
+    void requestTimeout(const Request &request);
+    void expireRequest(const Request &request);
+    void updateSequence(const Request &request, bool success);
+    void startSequence(void);
+    void sequenceFinished(const Sequence &sequence, bool success);
 
     bool interviewRequest(quint8 id, const Device &device);
-    bool interviewQuirks(const Device &device);
+    void interviewQuirks(const Device &device);
     void interviewDevice(const Device &device);
     void interviewFinished(const Device &device);
     void interviewError(const Device &device, const QString &reason);
 
-    bool configureDevice(const Device &device);
-    bool configureReporting(const Endpoint &endpoint, const Reporting &reporting);
-    bool bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address = QByteArray(), quint8 dstEndpointId = 0, bool unbind = false, bool manual = false);
-    bool groupRequest(const Endpoint &endpoint, quint16 groupId, bool remove = false, bool removeAll = false);
-    bool dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name);
+    void configureDevice(const Device &device);
+    void configureReporting(const Endpoint &endpoint, const Reporting &reporting);
+    void bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address = QByteArray(), quint8 dstEndpointId = 0, bool unbind = false, bool manual = false);
+    void groupRequest(const Endpoint &endpoint, quint16 groupId, bool remove = false, bool removeAll = false);
 
     bool parseProperty(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 itemId, const QByteArray &data, bool command = false);
     void parseAttribute(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 attributeId, quint8 dataType, const QByteArray &data);
@@ -207,6 +407,7 @@ private slots:
     void zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint16 clusterId, quint8 linkQuality, const QByteArray &payload);
     void rawMessageReveived(const QByteArray &ieeeAddress, quint16 clusterId, quint8 linkQuality, const QByteArray &data);
     void requestFinished(quint8 id, quint8 status);
+    void updateStatus(const QJsonObject &json);
 
     void handleRequests(void);
     void updateNeighbors(void);
@@ -224,11 +425,12 @@ signals:
     void deviceEvent(DeviceObject *device, ZigBee::Event event, const QJsonObject &json = QJsonObject());
     void endpointUpdated(DeviceObject *device, quint8 endpointId);
     void statusUpdated(const QJsonObject &json);
-    void replyReceived(void);
-    void groupRequestFinished(void);
 
 };
 
 Q_DECLARE_METATYPE(DataRequest)
+Q_DECLARE_METATYPE(BindingRequest)
+Q_DECLARE_METATYPE(GroupRequest)
+Q_DECLARE_METATYPE(ReportingRequest)
 
 #endif
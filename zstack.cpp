@@ -1,9 +1,10 @@
 #include <QtEndian>
 #include <QThread>
+#include "checksum.h"
 #include "logger.h"
 #include "zstack.h"
 
-ZStack::ZStack(QSettings *config, QObject *parent) : Adapter(config, parent), m_status(0), m_clear(false)
+ZStack::ZStack(QSettings *config, QObject *parent) : Adapter(config, parent), m_status(0), m_clear(false), m_requestTimer(new QTimer(this)), m_command(0), m_requestId(0), m_waiting(false), m_pipelined(false)
 {
     quint32 channelList = qToLittleEndian <quint32> (1 << m_channel);
 
@@ -15,6 +16,12 @@ ZStack::ZStack(QSettings *config, QObject *parent) : Adapter(config, parent), m_
     m_nvItems.insert(ZCD_NV_ZDO_DIRECT_CB,     QByteArray(1, 0x01));
 
     m_zdoClusters = {ZDO_NODE_DESCRIPTOR_REQUEST, ZDO_SIMPLE_DESCRIPTOR_REQUEST, ZDO_ACTIVE_ENDPOINTS_REQUEST, ZDO_BIND_REQUEST, ZDO_UNBIND_REQUEST, ZDO_LQI_REQUEST, ZDO_LEAVE_REQUEST};
+    m_congestionStatus = {ZSTACK_STATUS_MEMORY_ERROR, ZSTACK_STATUS_MAC_CCA_FAILURE, ZSTACK_STATUS_MAC_TRANSACTION_OVERFLOW, ZSTACK_STATUS_REQUEST_TIMEOUT};
+    m_deliveryStatus = {ZSTACK_STATUS_MAC_NO_ACK, ZSTACK_STATUS_APS_NO_ACK, ZSTACK_STATUS_NWK_NO_ROUTE};
+    m_macStatus = {ZSTACK_STATUS_MAC_NO_ACK};
+
+    connect(m_requestTimer, &QTimer::timeout, this, &ZStack::requestTimeout);
+    m_requestTimer->setSingleShot(true);
 }
 
 bool ZStack::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -30,7 +37,7 @@ bool ZStack::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPoin
     request.radius = ZSTACK_AF_DEFAULT_RADIUS;
     request.length = static_cast <quint8> (payload.length());
 
-    return sendRequest(ZSTACK_AF_DATA_REQUEST, QByteArray(reinterpret_cast <char*> (&request), sizeof(request)).append(payload)) && !m_replyStatus;
+    return enqueueRequest(id, ZSTACK_AF_DATA_REQUEST, QByteArray(reinterpret_cast <char*> (&request), sizeof(request)).append(payload));
 }
 
 bool ZStack::multicastRequest(quint8 id, quint16 groupId, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -93,7 +100,7 @@ bool ZStack::extendedRequest(quint8 id, const QByteArray &address, quint8 dstEnd
     data.radius = dstPanId ? ZSTACK_AF_DEFAULT_RADIUS * 2 : ZSTACK_AF_DEFAULT_RADIUS;
     data.length = qToLittleEndian <quint16> (payload.length());
 
-    return sendRequest(ZSTACK_AF_DATA_REQUEST_EXT, QByteArray(reinterpret_cast <char*> (&data), sizeof(data)).append(payload)) && !m_replyStatus;
+    return enqueueRequest(id, ZSTACK_AF_DATA_REQUEST_EXT, QByteArray(reinterpret_cast <char*> (&data), sizeof(data)).append(payload));
 }
 
 bool ZStack::extendedRequest(quint8 id, quint16 address, quint8 dstEndpointId, quint16 dstPanId, quint8 srcEndpointId, quint16 clusterId, const QByteArray &paylaod, bool group)
@@ -103,25 +110,60 @@ bool ZStack::extendedRequest(quint8 id, quint16 address, quint8 dstEndpointId, q
 }
 
 bool ZStack::sendRequest(quint16 command, const QByteArray &data)
+{
+    while (m_waiting || !m_requests.isEmpty())
+    {
+        if (waitForSignal(this, SIGNAL(dataReceived()), ZSTACK_REQUEST_TIMEOUT))
+            continue;
+
+        clearRequests();
+        break;
+    }
+
+    m_replyStatus = 0xFF;
+    m_pipelined = false;
+    writeRequest(command, data);
+
+    if (waitForSignal(this, SIGNAL(dataReceived()), ZSTACK_REQUEST_TIMEOUT))
+        return true;
+
+    m_waiting = false;
+    QTimer::singleShot(0, this, &ZStack::dispatchRequest);
+    return false;
+}
+
+bool ZStack::enqueueRequest(quint8 id, quint16 command, const QByteArray &data)
+{
+    m_requests.enqueue({id, command, data});
+
+    if (!m_waiting)
+        dispatchRequest();
+
+    return true;
+}
+
+void ZStack::writeRequest(quint16 command, const QByteArray &data)
 {
     QByteArray request;
-    quint8 fcs = 0;
 
     logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%04x", command) << data.toHex(':');
 
     m_command = qToBigEndian(command);
-    m_replyStatus = 0xFF;
+    m_waiting = true;
 
     request.append(ZSTACK_PACKET_FLAG);
     request.append(static_cast <char> (data.length()));
     request.append(reinterpret_cast <char*> (&m_command), sizeof(m_command));
     request.append(data);
 
-    for (int i = 1; i < request.length(); i++)
-        fcs ^= request[i];
+    sendData(request.append(static_cast <char> (xorChecksum(reinterpret_cast <const quint8*> (request.constData()) + 1, request.length() - 1))));
+}
 
-    sendData(request.append(static_cast <char> (fcs)));
-    return waitForSignal(this, SIGNAL(dataReceived()), ZSTACK_REQUEST_TIMEOUT);
+void ZStack::clearRequests(void)
+{
+    m_requests.clear();
+    m_requestTimer->stop();
+    m_waiting = false;
 }
 
 void ZStack::parsePacket(quint16 command, const QByteArray &data)
@@ -130,13 +172,30 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
 
     if (command & 0x2000)
     {
-        if ((command ^ 0x4000) == qFromBigEndian(m_command))
+        if (!m_waiting || (command ^ 0x4000) != qFromBigEndian(m_command))
+            return;
+
+        m_waiting = false;
+
+        if (m_pipelined)
+        {
+            quint8 status = static_cast <quint8> (data.at(0));
+
+            m_requestTimer->stop();
+
+            if (status)
+                emit requestFinished(m_requestId, status);
+
+            dispatchRequest();
+        }
+        else
         {
             m_replyStatus = static_cast <quint8> (data.at(0));
             m_replyData = data;
-            emit dataReceived();
+            QTimer::singleShot(0, this, &ZStack::dispatchRequest);
         }
 
+        emit dataReceived();
         return;
     }
 
@@ -152,6 +211,8 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
 
         case ZSTACK_SYS_RESET_IND:
         {
+            clearRequests();
+
             if (!startCoordinator())
             {
                 logWarning << "Coordinator startup failed";
@@ -509,7 +570,9 @@ bool ZStack::startCoordinator(void)
 
 void ZStack::softReset(void)
 {
+    clearRequests();
     sendData(QByteArray(1, ZSTACK_SKIP_BOOTLOADER));
+    flushData();
     QThread::msleep(RESET_DELAY);
     sendRequest(ZSTACK_SYS_RESET_REQ, QByteArray(1, 0x01));
 }
@@ -518,17 +581,18 @@ void ZStack::parseData(QByteArray &buffer)
 {
     while (!buffer.isEmpty())
     {
-        quint8 length, fcs = 0;
-
-        if (!buffer.at(0))
-            buffer.remove(0, 1);
+        quint8 length;
 
-        if (buffer.length() < 5 || buffer.at(0) != static_cast <char> (ZSTACK_PACKET_FLAG))
+        if (buffer.at(0) != static_cast <char> (ZSTACK_PACKET_FLAG))
         {
-            buffer.clear();
-            break;
+            int index = buffer.indexOf(static_cast <char> (ZSTACK_PACKET_FLAG));
+            buffer.remove(0, index < 0 ? buffer.length() : index);
+            continue;
         }
 
+        if (buffer.length() < 5)
+            break;
+
         length = static_cast <quint8> (buffer.at(1));
 
         if (buffer.length() < length + 5)
@@ -536,14 +600,11 @@ void ZStack::parseData(QByteArray &buffer)
 
         logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 5).toHex(':');
 
-        for (quint8 i = 1; i < length + 4; i++)
-            fcs ^= buffer.at(i);
-
-        if (fcs != static_cast <quint8> (buffer.at(length + 4)))
+        if (xorChecksum(reinterpret_cast <const quint8*> (buffer.constData()) + 1, length + 3) != static_cast <quint8> (buffer.at(length + 4)))
         {
             logWarning << "Frame" << buffer.mid(0, length + 5).toHex(':') << "FCS mismatch";
-            buffer.clear();
-            break;
+            buffer.remove(0, 1);
+            continue;
         }
 
         m_queue.enqueue(buffer.mid(2, length + 2));
@@ -569,6 +630,35 @@ bool ZStack::permitJoin(bool enabled)
     return true;
 }
 
+void ZStack::dispatchRequest(void)
+{
+    ZStackRequest request;
+
+    if (m_waiting || m_requests.isEmpty())
+        return;
+
+    request = m_requests.dequeue();
+
+    m_requestId = request.id;
+    m_pipelined = true;
+
+    writeRequest(request.command, request.data);
+    m_requestTimer->start(ZSTACK_REQUEST_TIMEOUT);
+}
+
+void ZStack::requestTimeout(void)
+{
+    logWarning << "Request" << QString::asprintf("0x%04x", qFromBigEndian(m_command)) << "response timed out";
+
+    m_waiting = false;
+
+    if (m_pipelined)
+        emit requestFinished(m_requestId, ZSTACK_STATUS_REQUEST_TIMEOUT);
+
+    dispatchRequest();
+    emit dataReceived();
+}
+
 void ZStack::handleQueue(void)
 {
     while (!m_queue.isEmpty())
@@ -13,6 +13,14 @@
 #define ZSTACK_AF_DISCV_ROUTE                   0x20
 #define ZSTACK_AF_DEFAULT_RADIUS                0x0F
 
+#define ZSTACK_STATUS_MEMORY_ERROR              0x10
+#define ZSTACK_STATUS_APS_NO_ACK                0xB7
+#define ZSTACK_STATUS_NWK_NO_ROUTE              0xCD
+#define ZSTACK_STATUS_MAC_CCA_FAILURE           0xE1
+#define ZSTACK_STATUS_MAC_NO_ACK                0xE9
+#define ZSTACK_STATUS_MAC_TRANSACTION_OVERFLOW  0xF1
+#define ZSTACK_STATUS_REQUEST_TIMEOUT           0xFF
+
 #define ZSTACK_SYS_VERSION                      0x2102
 #define ZSTACK_SYS_OSAL_NV_READ                 0x2108
 #define ZSTACK_SYS_OSAL_NV_WRITE                0x2109
@@ -218,6 +226,13 @@ struct zstackDeviceLeaveStruct
 
 #pragma pack(pop)
 
+struct ZStackRequest
+{
+    quint8 id;
+    quint16 command;
+    QByteArray data;
+};
+
 enum class ZStackVersion
 {
     ZStack3x0,
@@ -249,9 +264,15 @@ private:
     quint8 m_status;
     bool m_clear;
 
+    QTimer *m_requestTimer;
+
     quint16 m_command;
     QByteArray m_replyData;
 
+    QQueue <ZStackRequest> m_requests;
+    quint8 m_requestId;
+    bool m_waiting, m_pipelined;
+
     QMap <quint16, QByteArray> m_nvItems;
     QList <quint16> m_zdoClusters;
 
@@ -259,6 +280,9 @@ private:
     bool extendedRequest(quint8 id, quint16 address, quint8 dstEndpointId, quint16 dstPanId, quint8 srcEndpointId, quint16 clusterId, const QByteArray &paylaod, bool group = false);
 
     bool sendRequest(quint16 command, const QByteArray &data = QByteArray());
+    bool enqueueRequest(quint8 id, quint16 command, const QByteArray &data);
+    void writeRequest(quint16 command, const QByteArray &data);
+    void clearRequests(void);
     void parsePacket(quint16 command, const QByteArray &data);
 
     bool writeNvItem(quint16 id, const QByteArray &data);
@@ -271,6 +295,8 @@ private:
 
 private slots:
 
+    void dispatchRequest(void);
+    void requestTimeout(void);
     void handleQueue(void) override;
 
 signals: